@@ -0,0 +1,75 @@
+#ifndef ADAPTIVE_H
+#define ADAPTIVE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "metrics.h"
+#include "quantization.h"
+
+#define MIXED_BLOCK_SIZE     32     /* elements per block; at most 32 so a block's lanes fit a uint32_t mask */
+#define MIXED_SPARSE_K       4      /* values kept by a sparse block */
+#define MIXED_CHUNK_BLOCKS   64     /* blocks per chunk; chunk offsets make decode parallel and seekable */
+#define MIXED_PROFILE_FORMAT QUANTIZED_TYPE_COUNT   /* profiling format slot used by the mixed codec */
+
+/* Per-block encodings, 2 bits each in the type map, ordered from cheapest to most precise. */
+#define MIXED_BLOCK_ZERO    0       /* decodes to zeros, no payload */
+#define MIXED_BLOCK_SPARSE  1       /* top MIXED_SPARSE_K by magnitude: float scale, uint8 indices, int8 values */
+#define MIXED_BLOCK_Q4_0    2       /* q4_0 block: float scale, packed nibbles */
+#define MIXED_BLOCK_Q8_0    3       /* q8_0 block: float scale, int8 values */
+#define MIXED_BLOCK_TYPES   4
+
+/**
+ * @brief Selection target of mixed_quantize.
+ *
+ * With bits_per_element > 0 the encoder minimizes the estimated total squared error subject to
+ * the whole array (header, maps and payload) fitting in bits_per_element * num_elements / 8 bytes.
+ * Otherwise every block gets the cheapest encoding whose error bound is at most max_mse (the bound
+ * is conservative for q4_0, so a block may get q8_0 where q4_0 would just have fit).
+ *
+ * Cost: one statistics pass over the input (no trial encodes), an O(blocks log blocks) sort of
+ * the blocks' rate-distortion hull steps in budget mode, and one encode pass.
+ */
+typedef struct {
+    float bits_per_element;         /* budget mode when > 0 */
+    float max_mse;                  /* error-bound mode when bits_per_element == 0 */
+} mixed_config_t;
+
+/**
+ * @brief Mixed-format stream: each MIXED_BLOCK_SIZE-element block is encoded as zero, sparse,
+ * q4_0 or q8_0, recorded in a 2-bit per-block type map. Block payloads are packed back to back;
+ * chunk_offsets gives the payload offset of every MIXED_CHUNK_BLOCKS-th block.
+ */
+typedef struct {
+    uint64_t num_elements;          /* total elements in the original float array */
+    uint64_t num_blocks;            /* ceil(num_elements / MIXED_BLOCK_SIZE) */
+    uint64_t num_chunks;            /* ceil(num_blocks / MIXED_CHUNK_BLOCKS) */
+    uint64_t payload_size;          /* bytes of block payloads */
+    uint64_t block_counts[MIXED_BLOCK_TYPES];   /* blocks per encoding */
+    uint64_t *chunk_offsets;        /* num_chunks payload offsets */
+    uint8_t  *type_map;             /* block b in bits 2 * (b % 4) of byte b / 4 */
+    uint8_t  *payload;              /* payload_size bytes */
+} mixed_array_t;
+
+void free_mixed_array(mixed_array_t *mixed_array);
+
+uint64_t get_mixed_array_size(const mixed_array_t *mixed_array);
+
+mixed_array_t *load_mixed_array_from_buffer(const void *buffer, uint64_t buffer_size);
+
+/* Encoding of block b, one of MIXED_BLOCK_*. */
+uint8_t get_mixed_block_type(const mixed_array_t *mixed_array, uint64_t block_index);
+
+/* Chooses an encoding per block for *config and encodes; metrics (may be NULL) gets the actual error. */
+int mixed_quantize(const float *float_array,
+                   uint64_t num_elements,
+                   const mixed_config_t *config,
+                   mixed_array_t **mixed_array,
+                   codec_metrics_t *metrics);
+
+int mixed_dequantize(const mixed_array_t *mixed_array,
+                     float *float_array);
+
+#endif
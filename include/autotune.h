@@ -0,0 +1,83 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define AUTOTUNE_MAX_SHAPES 64      /* registered shapes per profile */
+
+/* tuned codec entry points */
+#define AUTOTUNE_OP_QUANTIZE 0      /* quantize / quantize_with_metrics / quantize_into */
+#define AUTOTUNE_OP_COMPRESS 1      /* compress / compress_with_metrics */
+
+/* compress top-k kernels; both produce identical sparse arrays */
+#define AUTOTUNE_TOPK_SORT   0      /* qsort the whole row */
+#define AUTOTUNE_TOPK_SELECT 1      /* quickselect the kept features, then sort only those */
+
+/**
+ * @brief Execution settings of one codec call.
+ *
+ * The codecs fill it with their defaults and let autotune_apply() replace them with the tuned
+ * values of the installed profile, if any.
+ */
+typedef struct {
+    uint32_t num_threads;           /* OpenMP threads for the call */
+    uint32_t chunk;                 /* quantize: blocks per scheduling step; compress: tokens per step */
+    uint8_t  kernel;                /* compress: AUTOTUNE_TOPK_*; unused by quantize */
+} autotune_config_t;
+
+/* One registered shape and, once tuned, its winning configuration. */
+typedef struct {
+    uint8_t  op;                    /* AUTOTUNE_OP_* */
+    uint8_t  format;                /* quantized_type for AUTOTUNE_OP_QUANTIZE, 0 for compress */
+    uint16_t num_features;          /* compress: row length; 0 for quantize */
+    uint16_t num_kept;              /* compress: retained features per token; 0 for quantize */
+    uint8_t  tuned;                 /* 1 once config holds a measured winner */
+    uint64_t num_elements;
+    autotune_config_t config;
+    double   time_us;               /* best time of the winner */
+} autotune_entry_t;
+
+typedef struct {
+    uint64_t num_entries;
+    autotune_entry_t entries[AUTOTUNE_MAX_SHAPES];
+} autotune_profile_t;
+
+/* ---- Building a profile --------------------------------------------------- */
+
+/* Start from a zeroed profile (memset or = {0}); registering an existing shape is a no-op. */
+int autotune_register_quantize(autotune_profile_t *profile, uint8_t quantized_type, uint64_t num_elements);
+
+int autotune_register_compress(autotune_profile_t *profile, uint16_t num_tokens, uint16_t num_features,
+                               float sparse_ratio);
+
+/*
+ * Benchmarks every candidate thread count, chunk size and kernel on random data of each registered
+ * shape (best of `repetitions` runs) and stores the winners in the profile.
+ */
+int autotune_run(autotune_profile_t *profile, uint32_t repetitions);
+
+/* Text format, one shape per line: op format num_elements num_features num_kept threads chunk kernel time_us */
+int autotune_save_profile(const autotune_profile_t *profile, const char *path);
+
+int autotune_load_profile(autotune_profile_t *profile, const char *path);
+
+/* ---- Using a profile ------------------------------------------------------- */
+
+/*
+ * Installs the profile used by subsequent codec calls on every thread, or restores the built-in
+ * defaults for NULL. The profile is not copied and must stay alive and unmodified while installed.
+ */
+void autotune_set_profile(const autotune_profile_t *profile);
+
+/*
+ * Overwrites *config with the tuned settings for a call of this shape: the exact registered shape
+ * if present, otherwise the tuned shape of the same op and format closest in size. Leaves *config
+ * untouched when nothing applies. Thread counts are capped at omp_get_max_threads().
+ */
+void autotune_apply(uint8_t op, uint8_t format, uint64_t num_elements, uint16_t num_features,
+                    uint16_t num_kept, autotune_config_t *config);
+
+#endif
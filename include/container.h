@@ -0,0 +1,119 @@
+#ifndef CONTAINER_H
+#define CONTAINER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "quantization.h"
+#include "sparsity.h"
+
+#define CONTAINER_MAGIC      "QSPCONT1"     /* first 8 bytes of every container file */
+#define CONTAINER_VERSION    1
+#define CONTAINER_ALIGNMENT  64             /* payload offsets are multiples of this */
+#define CONTAINER_MAX_NAME   64             /* bytes per tensor name, including the terminating NUL */
+#define CONTAINER_MAX_DIMS   4
+
+/* payload codecs */
+#define CONTAINER_CODEC_QUANTIZED 0         /* a serialized quantized_array_t */
+#define CONTAINER_CODEC_SPARSE    1         /* a serialized sparse_array_t */
+
+/**
+ * @brief Fixed header at offset 0 of a container file.
+ *
+ * Layout: [header][payload 0][pad][payload 1][pad] ... [index]. Payloads are the codec's own
+ * serialized form (struct header followed by its data, as sized by get_*_size) and start on
+ * CONTAINER_ALIGNMENT boundaries. The index of num_tensors container_entry_t follows the last
+ * payload; index_offset stays 0 until the writer is finalized, so a file whose writer never
+ * finished is rejected instead of being read half-written.
+ */
+typedef struct {
+    char     magic[8];                      /* CONTAINER_MAGIC, not NUL-terminated */
+    uint32_t version;                       /* CONTAINER_VERSION */
+    uint32_t alignment;                     /* CONTAINER_ALIGNMENT at write time */
+    uint64_t num_tensors;                   /* entries in the index */
+    uint64_t index_offset;                  /* file offset of the index, 0 while writing */
+    uint8_t  reserved[32];
+} container_header_t;
+
+/* One index entry; the name table, shapes and codecs of every tensor live in the index. */
+typedef struct {
+    char     name[CONTAINER_MAX_NAME];      /* NUL-terminated, unique within the file */
+    uint8_t  codec;                         /* CONTAINER_CODEC_* */
+    uint8_t  quantized_type;                /* quantized_type of a quantized payload, 0 otherwise */
+    uint8_t  num_dims;                      /* used entries of shape */
+    uint8_t  reserved[5];
+    uint64_t shape[CONTAINER_MAX_DIMS];     /* logical tensor shape, outermost first */
+    uint64_t offset;                        /* file offset of the payload */
+    uint64_t size;                          /* payload bytes */
+} container_entry_t;
+
+/**
+ * @brief Append-only writer. Payloads are streamed to the file as they are added; only the
+ * index is kept in memory and written by finalize_container. After a failed write the file no
+ * longer matches the index, so every later append and finalize_container fail as well.
+ */
+typedef struct {
+    FILE              *file;
+    uint64_t           offset;              /* end of the last payload */
+    uint64_t           num_tensors;
+    uint64_t           capacity;            /* slots in entries */
+    container_entry_t *entries;
+    uint64_t           num_slots;           /* power-of-two size of the name hash table */
+    uint64_t          *slots;               /* entry index + 1 per slot, 0 for empty */
+    int                failed;              /* a write failed; sticky */
+} container_writer_t;
+
+/**
+ * @brief Read-only view of a finalized container. The file is memory-mapped, so opening it
+ * reads only the header and index; tensor payloads are paged in when a view touches them.
+ */
+typedef struct {
+    const uint8_t           *base;          /* start of the mapping */
+    uint64_t                 file_size;
+    uint64_t                 num_tensors;
+    const container_entry_t *entries;       /* the index, inside the mapping */
+    uint64_t                 num_slots;     /* power-of-two size of the name hash table */
+    uint64_t                *slots;         /* entry index + 1 per slot, 0 for empty */
+} container_reader_t;
+
+/* ---- Writing ------------------------------------------------------------- */
+
+container_writer_t *create_container(const char *path);
+
+/* Appends a quantized tensor; num_dims / shape describe its logical shape (num_dims 0 means flat). */
+int append_quantized_to_container(container_writer_t *writer,
+                                  const char *name,
+                                  const uint64_t *shape,
+                                  uint8_t num_dims,
+                                  const quantized_array_t *quantized_array);
+
+/* Appends a sparse tensor; its shape is [num_tokens, num_features]. */
+int append_sparse_to_container(container_writer_t *writer,
+                               const char *name,
+                               const sparse_array_t *sparse_array);
+
+/* Writes the index, patches the header, closes the file and frees the writer (also on failure). */
+int finalize_container(container_writer_t *writer);
+
+/* ---- Reading ------------------------------------------------------------- */
+
+container_reader_t *open_container(const char *path);
+
+/* Unmaps the file; views obtained from the reader become invalid. */
+void close_container(container_reader_t *reader);
+
+/* O(1) lookup by name, NULL if absent. */
+const container_entry_t *find_in_container(const container_reader_t *reader, const char *name);
+
+/* Zero-copy views: *view points into the mapping and must not be written or freed. */
+int view_quantized_from_container(const container_reader_t *reader,
+                                  const container_entry_t *entry,
+                                  quantized_array_t *view);
+
+int view_sparse_from_container(const container_reader_t *reader,
+                               const container_entry_t *entry,
+                               sparse_array_t *view);
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef KV_CACHE_H
+#define KV_CACHE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "quantization.h"
+
+/**
+ * @brief Append-only quantized token cache (KV / activation cache) for a decode loop.
+ *
+ * Tokens of num_features floats are quantized once on append, row-wise (see token_quantized_array_t),
+ * into fixed-size pages of tokens_per_page rows. Memory grows a whole page at a time: the first append
+ * past the last page callocs a new one (e.g. 64 rows of about 4 or 8 bits per element plus the group
+ * scales), and the page table doubles when it is full. Any token window can be dequantized on read
+ * without touching the other pages.
+ */
+typedef struct {
+    uint8_t  quantized_type;            /* 0: q8_0, 1: q4_0 */
+    uint16_t num_features;              /* floats per token */
+    uint16_t group_size;                /* features per scale, see token_quantized_array_t */
+    uint16_t tokens_per_page;           /* token rows per page */
+    uint64_t num_tokens;                /* tokens appended so far */
+    uint64_t num_pages;                 /* pages in use */
+    uint64_t page_capacity;             /* slots in the page table */
+    token_quantized_array_t **pages;    /* page table; page p holds tokens [p * tokens_per_page, (p + 1) * tokens_per_page) */
+} quantized_cache_t;
+
+quantized_cache_t *allocate_quantized_cache(uint16_t num_features,
+                                            uint8_t quantized_type,
+                                            uint16_t group_size,
+                                            uint16_t tokens_per_page);
+
+void free_quantized_cache(quantized_cache_t *cache);
+
+/* Resident bytes: the cache header, the page table and every allocated page. */
+uint64_t get_quantized_cache_size(const quantized_cache_t *cache);
+
+/* Quantizes num_tokens rows of num_features floats and appends them after the last cached token. */
+int append_to_quantized_cache(quantized_cache_t *cache,
+                              const float *float_array,
+                              uint64_t num_tokens);
+
+/* Dequantizes tokens [first_token, first_token + num_tokens) into float_array. */
+int read_from_quantized_cache(const quantized_cache_t *cache,
+                              uint64_t first_token,
+                              uint64_t num_tokens,
+                              float *float_array);
+
+/* Drops every token after the first num_tokens (e.g. rejected speculative tokens), keeping the pages. */
+int truncate_quantized_cache(quantized_cache_t *cache, uint64_t num_tokens);
+
+#endif
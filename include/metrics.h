@@ -0,0 +1,28 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <math.h>
+
+/**
+ * @brief Reconstruction error statistics gathered by the codecs as a by-product of encoding.
+ *
+ * The error is measured between the original float array and what the matching decode
+ * (dequantize / decompress) would return, without materializing the decoded array.
+ */
+typedef struct {
+    double mae;         /* mean absolute error */
+    double mse;         /* mean squared error */
+    double max_abs;     /* maximum absolute error */
+    double sqnr_db;     /* signal to quantization noise ratio in dB, INFINITY for lossless */
+} codec_metrics_t;
+
+/* Turns the sums reduced by a codec kernel into the final metrics. */
+void codec_metrics_finalize(double sum_abs_error,
+                            double sum_sq_error,
+                            double max_abs_error,
+                            double sum_sq_signal,
+                            uint64_t num_elements,
+                            codec_metrics_t *metrics);
+
+#endif
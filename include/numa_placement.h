@@ -0,0 +1,68 @@
+#ifndef NUMA_PLACEMENT_H
+#define NUMA_PLACEMENT_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUMA_MAX_NODES  64
+#define NUMA_MAX_CPUS   1024            /* CPU ids above this are ignored */
+#define NUMA_SYSFS_NODE "/sys/devices/system/node/node%u/cpulist"
+
+/* execution options, combined with | */
+#define NUMA_PIN_THREADS 0x1            /* bind each codec worker to one CPU */
+#define NUMA_NODE_POOLS  0x2            /* bind each codec worker to all CPUs of its node */
+#define NUMA_FIRST_TOUCH 0x4            /* allocate_* let the writing workers fault in the output pages */
+
+/*
+ * Placed codecs: quantize*, quantize_into, compress* and compress_into bind their workers and, with
+ * NUMA_FIRST_TOUCH, write the pages their allocation faulted in. quantize_rotated* binds its tile
+ * workers too, but the pages follow the plain quantize split, so they match only to tile granularity.
+ * Token-quantized arrays, the KV cache pages and mixed (adaptive) arrays are not NUMA-placed.
+ */
+
+/**
+ * @brief CPUs of every NUMA node that has any.
+ *
+ * Read from sysfs; a host without it (or without NUMA) is reported as a single node holding the
+ * CPUs the process may run on.
+ */
+typedef struct {
+    uint32_t num_nodes;
+    uint32_t num_cpus;
+    uint32_t node_ids[NUMA_MAX_NODES];              /* sysfs node number of each entry */
+    uint32_t node_offsets[NUMA_MAX_NODES + 1];      /* CPUs of node n: cpus[node_offsets[n], node_offsets[n + 1]) */
+    uint16_t cpus[NUMA_MAX_CPUS];
+} numa_topology_t;
+
+/* Parses a sysfs cpulist such as "0-3,8,10-11"; returns 0 on success. */
+int numa_parse_cpulist(const char *cpulist, uint16_t *cpus, uint32_t max_cpus, uint32_t *num_cpus);
+
+/* Copies the topology, detecting it on first use. */
+void numa_get_topology(numa_topology_t *topology);
+
+/*
+ * Sets the NUMA_* options for subsequent codec calls (0 restores the defaults, unpinning workers
+ * on their next codec call). Not to be called while codecs run. Returns 1, leaving the options
+ * unchanged, if thread affinity is unavailable.
+ */
+int numa_set_options(uint32_t options);
+
+uint32_t numa_get_options(void);
+
+/*
+ * Workers of a team of num_threads are split into contiguous groups, one per node, in node order:
+ * with the static block-range schedule of the codecs, node n owns the n-th slice of the array.
+ */
+uint32_t numa_node_of_worker(uint32_t thread_num, uint32_t num_threads);
+
+/*
+ * Applies the pinning options to the calling worker; codecs call it at the top of parallel regions.
+ * Thread 0 is the codec's caller: its affinity is saved first and put back by numa_release_worker.
+ */
+void numa_bind_worker(uint32_t thread_num, uint32_t num_threads);
+
+/* Restores thread 0's affinity from before numa_bind_worker; codecs call it at the end of the region. */
+void numa_release_worker(uint32_t thread_num);
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef PROFILING_H
+#define PROFILING_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Per-thread performance counters and optional tracing hooks for the codec entry
+ * points (quantize, dequantize, compress, decompress).
+ *
+ * Counters are compiled in with -DENABLE_PROFILING and the begin/end hooks with
+ * -DENABLE_TRACING (see the PROFILING / TRACING switches in the Makefile). When
+ * neither is defined the CODEC_PROFILE_* macros expand to nothing, so the codecs
+ * carry no instrumentation at all. The snapshot / reset / hook setters are always
+ * available and simply report zeros or do nothing in that case.
+ */
+
+#define CODEC_PROFILE_MAX_FORMATS 16    /* quantized_type values, then mixed and per-token slots; sparse codecs use format 0 */
+#define CODEC_PROFILE_MAX_THREADS 64    /* per-thread slots; extra threads share slots atomically */
+
+typedef enum {
+    CODEC_OP_QUANTIZE = 0,
+    CODEC_OP_DEQUANTIZE,
+    CODEC_OP_COMPRESS,
+    CODEC_OP_DECOMPRESS,
+    CODEC_OP_COUNT
+} codec_op_t;
+
+typedef struct {
+    uint64_t calls;         /* number of completed calls */
+    uint64_t elements;      /* float elements processed */
+    uint64_t bytes_in;      /* bytes read (float array for encode, codec buffer for decode) */
+    uint64_t bytes_out;     /* bytes produced (codec buffer for encode, float array for decode) */
+    uint64_t ns;            /* wall time spent inside the call */
+} codec_counters_t;
+
+typedef struct {
+    codec_counters_t counters[CODEC_OP_COUNT][CODEC_PROFILE_MAX_FORMATS];
+} codec_profile_t;
+
+typedef void (*codec_trace_hook_t)(codec_op_t op, uint8_t format, uint64_t num_elements, void *user_data);
+
+/* Sums every thread's counters into *snapshot without taking any lock. */
+void codec_profile_snapshot(codec_profile_t *snapshot);
+
+/* Zeroes all counters; updates racing with the reset may be partially lost. */
+void codec_profile_reset(void);
+
+/* Installs begin/end hooks (either may be NULL); ignored unless built with ENABLE_TRACING. */
+void codec_set_trace_hooks(codec_trace_hook_t begin, codec_trace_hook_t end, void *user_data);
+
+/* Used by the codecs through the macros below. */
+uint64_t codec_profile_begin(codec_op_t op, uint8_t format, uint64_t num_elements);
+
+void codec_profile_end(codec_op_t op, uint8_t format, uint64_t num_elements,
+                       uint64_t bytes_in, uint64_t bytes_out, uint64_t start_ns);
+
+#if defined(ENABLE_PROFILING) || defined(ENABLE_TRACING)
+#define CODEC_PROFILE_BEGIN(op, format, n) \
+    const uint64_t _codec_profile_start = codec_profile_begin((op), (format), (n))
+#define CODEC_PROFILE_END(op, format, n, bytes_in, bytes_out) \
+    codec_profile_end((op), (format), (n), (bytes_in), (bytes_out), _codec_profile_start)
+#else
+/* the arguments stay unevaluated, but count as used, so locals kept only for profiling do not warn */
+#define CODEC_PROFILE_BEGIN(op, format, n) ((void)sizeof(op), (void)sizeof(format), (void)sizeof(n))
+#define CODEC_PROFILE_END(op, format, n, bytes_in, bytes_out) \
+    ((void)sizeof(op), (void)sizeof(format), (void)sizeof(n), (void)sizeof(bytes_in), (void)sizeof(bytes_out))
+#endif
+
+#endif
@@ -6,38 +6,181 @@
 #include <string.h>
 #include <math.h>
 
+#include "metrics.h"
+
 /* The setting is refer to https://huggingface.co/docs/hub/en/gguf */
 #define DEFAULT_Q8_0_BLOCK_SIZE 32
 #define DEFAULT_Q4_0_BLOCK_SIZE 32
+#define DEFAULT_Q4_1_BLOCK_SIZE 32
+#define DEFAULT_Q5_0_BLOCK_SIZE 32
+#define DEFAULT_Q5_1_BLOCK_SIZE 32
+#define DEFAULT_Q8_1_BLOCK_SIZE 32
 #define DEFAULT_Q4_K_SUPER_BLOCK_SIZE 8
 
+/* quantized_type values; q4_1 / q5_1 add a per-block min, q5_* a high-bit plane, q8_1 the block sum */
+#define QUANTIZED_TYPE_Q8_0  0
+#define QUANTIZED_TYPE_Q4_0  1
+#define QUANTIZED_TYPE_Q4_1  2
+#define QUANTIZED_TYPE_Q5_0  3
+#define QUANTIZED_TYPE_Q5_1  4
+#define QUANTIZED_TYPE_Q8_1  5
+#define QUANTIZED_TYPE_COUNT 6
+
 typedef struct {
-    uint8_t  quantized_type; /* 0: q8_0, 1: q4_0, … */
+    uint8_t  quantized_type; /* 0: q8_0, 1: q4_0, 2: q4_1, 3: q5_0, 4: q5_1, 5: q8_1 */
+    uint32_t rotation_size;  /* Hadamard block the data was rotated with before quantizing, 0 for none */
     uint64_t num_elements;   /* total elements in the original float array */
     uint64_t num_blocks;     /* number of blocks (for block‑wised formats) */
     uint64_t block_size;     /* elements per block */
-    float  *scales;          /* length = num_blocks (or num_superblocks for kquant formats) */
-    int8_t *data;            /* for kquant, here need to contain quantized scale value + quantized value, otherwise it only need to store quantized value*/
+    float  *scales;          /* length = num_blocks (or num_superblocks for kquant formats); interleaved {d, m} for q4_1 / q5_1 and {d, s = d * sum(q)} for q8_1 */
+    int8_t *data;            /* for kquant, here need to contain quantized scale value + quantized value, otherwise it only need to store quantized value; q5_* append a high-bit plane (bit e % 8 of byte e / 8) after the packed nibbles */
 } quantized_array_t;
 
+/**
+ * @brief Row-wise quantization of a 2D tensor with shape [num_tokens, num_features].
+ *
+ * Every token row is self-contained and contiguous: num_groups float scales followed by the row's
+ * q8_0 / q4_0 values, padded to row_size bytes. A single token can therefore be encoded, decoded or
+ * shipped on its own (rows + token_index * row_size). group_size == num_features gives one scale per token.
+ */
+typedef struct {
+    uint8_t  quantized_type;    /* 0: q8_0, 1: q4_0 */
+    uint16_t num_tokens;        /* rows in the 2D shape */
+    uint16_t num_features;      /* columns in the 2D shape */
+    uint16_t group_size;        /* features per scale */
+    uint16_t num_groups;        /* scales per token, ceil(num_features / group_size) */
+    uint64_t row_size;          /* bytes per token row, a multiple of sizeof(float) */
+    uint8_t *rows;              /* num_tokens * row_size bytes */
+} token_quantized_array_t;
+
 quantized_array_t *allocate_q8_0_array(uint64_t num_elements,
                                        uint64_t block_size);
 
 quantized_array_t *allocate_q4_0_array(uint64_t num_elements,
                                        uint64_t block_size);                                       
 
+quantized_array_t *allocate_q4_1_array(uint64_t num_elements,
+                                       uint64_t block_size);
+
+quantized_array_t *allocate_q5_0_array(uint64_t num_elements,
+                                       uint64_t block_size);
+
+quantized_array_t *allocate_q5_1_array(uint64_t num_elements,
+                                       uint64_t block_size);
+
+quantized_array_t *allocate_q8_1_array(uint64_t num_elements,
+                                       uint64_t block_size);
+
 void free_quantized_array(quantized_array_t *quantized_array);
 
 int64_t get_quantized_array_size(const quantized_array_t *quantized_array);
 
 quantized_array_t *load_quantized_array_from_buffer(const void *buffer, int64_t buffer_size);
 
+/**
+ * @brief Zero-copy counterpart of load_quantized_array_from_buffer: fills *view with the buffer's
+ * header and points scales / data into the buffer, which must outlive the view and is not written.
+ * @return 0 on success, 1 if the buffer does not hold a consistent quantized array.
+ */
+int view_quantized_array_from_buffer(const void *buffer, uint64_t buffer_size, quantized_array_t *view);
+
 int quantize(const float *float_array,
              uint64_t num_elements,
              uint8_t quantized_type,
              quantized_array_t **quantized_array);
 
+/* Same as quantize(), also filling *metrics with the error dequantize() would show (metrics may be NULL). */
+int quantize_with_metrics(const float *float_array,
+                          uint64_t num_elements,
+                          uint8_t quantized_type,
+                          quantized_array_t **quantized_array,
+                          codec_metrics_t *metrics);
+
+/*
+ * Quantizes into an array from any allocate_*_array, honouring its block_size. Returns 1, leaving
+ * the array untouched, for a rotated array (rotation_size != 0): its decodes would undo a rotation
+ * the new data never had.
+ */
+int quantize_into(const float *float_array,
+                  quantized_array_t *quantized_array,
+                  codec_metrics_t *metrics);
+
+/**
+ * @brief Quantizes a [num_elements / num_features, num_features] tensor after an orthonormal
+ * Hadamard rotation of every row (block-diagonal with hadamard_block_size(num_features) blocks).
+ *
+ * The rotation spreads outlier features over their block so 4-bit formats keep their accuracy.
+ * The block size is recorded in rotation_size and every decode (dequantize, dequantize_range,
+ * dequantize_rows) undoes the rotation, so callers always get the original basis back.
+ *
+ * Returns 1 when hadamard_block_size(num_features) is below HADAMARD_MIN_BLOCK_SIZE, e.g. for an
+ * odd num_features or 3000 = 375 * 8; use plain quantize() for such rows.
+ */
+int quantize_rotated(const float *float_array,
+                     uint64_t num_elements,
+                     uint64_t num_features,
+                     uint8_t quantized_type,
+                     quantized_array_t **quantized_array);
+
+/* Same as quantize_rotated(), also filling *metrics with the error dequantize() would show, measured
+ * against the unrotated input (metrics may be NULL). */
+int quantize_rotated_with_metrics(const float *float_array,
+                                  uint64_t num_elements,
+                                  uint64_t num_features,
+                                  uint8_t quantized_type,
+                                  quantized_array_t **quantized_array,
+                                  codec_metrics_t *metrics);
+
 int dequantize(const quantized_array_t *quantized_array,
                float *float_array);
 
+/* Decodes elements [first_element, first_element + num_elements) into float_array[0 .. num_elements). */
+int dequantize_range(const quantized_array_t *quantized_array,
+                     uint64_t first_element,
+                     uint64_t num_elements,
+                     float *float_array);
+
+/* Decodes token rows [first_token, first_token + num_tokens) of a flattened [tokens, num_features] tensor. */
+int dequantize_rows(const quantized_array_t *quantized_array,
+                    uint64_t num_features,
+                    uint64_t first_token,
+                    uint64_t num_tokens,
+                    float *float_array);
+
+/* ---- Per-token quantization ---------------------------------------------- */
+
+/* profiling format slot of per-token q8_0 / q4_0, after the flat formats and MIXED_PROFILE_FORMAT */
+#define TOKEN_PROFILE_FORMAT(quantized_type) (QUANTIZED_TYPE_COUNT + 1 + (quantized_type))
+
+/* group_size 0 means one group per token; q4_0 needs an even group_size unless it spans the row. */
+token_quantized_array_t *allocate_token_quantized_array(uint16_t num_tokens,
+                                                        uint16_t num_features,
+                                                        uint8_t quantized_type,
+                                                        uint16_t group_size);
+
+void free_token_quantized_array(token_quantized_array_t *token_array);
+
+uint64_t get_token_quantized_array_size(const token_quantized_array_t *token_array);
+
+token_quantized_array_t *load_token_quantized_array_from_buffer(const void *buffer, uint64_t buffer_size);
+
+int quantize_tokens(const float *float_array,
+                    uint16_t num_tokens,
+                    uint16_t num_features,
+                    uint8_t quantized_type,
+                    uint16_t group_size,
+                    token_quantized_array_t **token_array);
+
+int dequantize_tokens(const token_quantized_array_t *token_array,
+                      float *float_array);
+
+/* Encodes / decodes a single token row of num_features floats in place. */
+int quantize_token_row(const float *row,
+                       token_quantized_array_t *token_array,
+                       uint16_t token_index);
+
+int dequantize_token_row(const token_quantized_array_t *token_array,
+                         uint16_t token_index,
+                         float *row);
+
 #endif
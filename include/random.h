@@ -6,6 +6,40 @@
 #include <time.h>
 #include <math.h>
 
+/*
+ * Counter-based generator (Philox4x32-10): element i of a stream depends only on (seed, i),
+ * so any range can be produced directly (jump-ahead), generation splits freely across OpenMP
+ * threads, and the output is identical for every thread count.
+ */
+
+typedef enum {
+    RANDOM_UNIFORM = 0,         /* uniform in [minv, maxv) */
+    RANDOM_NORMAL,              /* normal with mean / stddev */
+    RANDOM_ACTIVATION           /* heavy-tailed (Laplace) body with outlier channels, LLM activation like */
+} random_distribution_t;
+
+typedef struct {
+    random_distribution_t distribution;
+    float minv, maxv;           /* RANDOM_UNIFORM range */
+    float mean, stddev;         /* RANDOM_NORMAL moments; RANDOM_ACTIVATION uses stddev as the body scale */
+    uint64_t num_features;      /* RANDOM_ACTIVATION: row length, the channel of element i is i % num_features */
+    float outlier_ratio;        /* RANDOM_ACTIVATION: fraction of channels that are outliers */
+    float outlier_scale;        /* RANDOM_ACTIVATION: magnitude multiplier applied to outlier channels */
+} random_config_t;
+
+/* Fills float_array with elements [offset, offset + num_elements) of the stream selected by seed. */
+int fill_random_float_array(float *float_array,
+                            uint64_t num_elements,
+                            const random_config_t *config,
+                            uint64_t seed,
+                            uint64_t offset);
+
+/* Allocates one contiguous buffer of num_elements and fills it from offset 0; release with free(). */
+float *gen_random_float_buffer(uint64_t num_elements,
+                               const random_config_t *config,
+                               uint64_t seed);
+
+/* count uniform arrays of N elements, backed by a single contiguous buffer (arrs[i] = arrs[0] + i * N). */
 float **gen_random_float_arrays(uint64_t count,
                                 uint64_t N,
                                 float minv,
@@ -0,0 +1,40 @@
+#ifndef ROTATION_H
+#define ROTATION_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+
+/* largest Hadamard block used for rotation; bounds the O(F log F) cost per block */
+#define HADAMARD_MAX_BLOCK_SIZE 32768
+
+/* smallest block quantize_rotated accepts: narrower blocks spread an outlier over too few values */
+#define HADAMARD_MIN_BLOCK_SIZE 32
+
+/**
+ * @brief In-place orthonormal fast Walsh-Hadamard transform of every block_size-element block.
+ *
+ * data holds num_elements floats split into consecutive blocks of block_size (a power of two);
+ * each block is replaced by H * x / sqrt(block_size). The transform is its own inverse, so the
+ * same call undoes it. Blocks are processed in parallel.
+ *
+ * @return 0 on success, 1 on invalid arguments.
+ */
+int hadamard_transform(float *data,
+                       uint64_t num_elements,
+                       uint64_t block_size);
+
+/* Same as hadamard_transform() on the calling thread, for callers already inside a parallel region. */
+int hadamard_transform_local(float *data,
+                             uint64_t num_elements,
+                             uint64_t block_size);
+
+/**
+ * @brief Hadamard block size for rows of num_features features.
+ *
+ * The largest power of two dividing num_features, capped at HADAMARD_MAX_BLOCK_SIZE; rows of a
+ * size that is not a power of two get a block-diagonal Hadamard, e.g. 3584 = 7 blocks of 512.
+ */
+uint64_t hadamard_block_size(uint64_t num_features);
+
+#endif
@@ -7,6 +7,8 @@
 #include <math.h>
 #include <omp.h>
 
+#include "metrics.h"
+
 /**
  * @brief Represents a sparse array in zero-based COO format for 2D data with shape [num_tokens, num_features].
  *
@@ -22,6 +24,9 @@ typedef struct {
     float *values;                      /* Flattened array of corresponding sparse values; length is (num_tokens * num_sparse_features). */
 } sparse_array_t;
 
+/* Features kept per token for sparse_ratio: round(num_features * sparse_ratio), at least 1 when the ratio is positive. */
+uint16_t get_num_sparse_features(uint16_t num_features, float sparse_ratio);
+
 sparse_array_t *allocate_sparse_array(uint16_t num_tokens, uint16_t num_features, float sparse_ratio);                               
 
 void free_sparse_array(sparse_array_t *sparse_array);
@@ -30,8 +35,24 @@ uint64_t get_sparse_array_size(const sparse_array_t *sparse_array);
 
 sparse_array_t *load_sparse_array_from_buffer(const void *buffer, uint64_t buffer_size);
 
+/* Zero-copy counterpart of load_sparse_array_from_buffer; the buffer must outlive the view. Returns 0 on success. */
+int view_sparse_array_from_buffer(const void *buffer, uint64_t buffer_size, sparse_array_t *view);
+
 int compress(const float *float_array, uint16_t num_tokens, uint16_t num_features,  float sparse_ratio, sparse_array_t **sparse_array);
 
+/* Same as compress(), also filling *metrics with the error decompress() would show (metrics may be NULL). */
+int compress_with_metrics(const float *float_array, uint16_t num_tokens, uint16_t num_features, float sparse_ratio,
+                          sparse_array_t **sparse_array, codec_metrics_t *metrics);
+
+/* Compresses into an array from allocate_sparse_array, whose shape and kept features it takes. */
+int compress_into(const float *float_array, sparse_array_t *sparse_array, codec_metrics_t *metrics);
+
 int decompress(const sparse_array_t *sparse_array, float *float_array);
 
+/* Decodes tokens [first_token, first_token + num_tokens) into float_array, shape [num_tokens, num_features]. */
+int decompress_rows(const sparse_array_t *sparse_array, uint16_t first_token, uint16_t num_tokens, float *float_array);
+
+/* Decodes the listed tokens, in list order, into float_array, shape [num_selected, num_features]. */
+int decompress_tokens(const sparse_array_t *sparse_array, const uint16_t *token_indices, uint16_t num_selected, float *float_array);
+
 #endif
@@ -0,0 +1,472 @@
+#include "adaptive.h"
+#include "block_kernels.h"
+#include "profiling.h"
+
+#define MIXED_NOISE_EXPECTED (1.0f / 12.0f)  /* mean squared rounding error per step^2 (budget mode) */
+#define MIXED_NOISE_BOUND    (1.0f / 4.0f)   /* worst case, half a step everywhere (error-bound mode) */
+
+/* ---- Layout ----------------------------------------------------------------- */
+
+static uint64_t _get_block_payload_size(uint8_t block_type, uint64_t n) {
+    switch (block_type) {
+        case MIXED_BLOCK_SPARSE:
+            return sizeof(float) + MIXED_SPARSE_K * (sizeof(uint8_t) + sizeof(int8_t));
+        case MIXED_BLOCK_Q4_0:
+            return sizeof(float) + (n + 1) / 2;
+        case MIXED_BLOCK_Q8_0:
+            return sizeof(float) + n * sizeof(int8_t);
+        default: /* MIXED_BLOCK_ZERO */
+            return 0;
+    }
+}
+
+/* type map bytes, padded so the payload (and every full block's scale) stays 4-byte aligned */
+static uint64_t _get_type_map_size(uint64_t num_blocks) {
+    return ((num_blocks + 3) / 4 + 3) / 4 * 4;
+}
+
+/* Bytes in front of the payload: header, chunk offsets and type map. */
+static uint64_t _get_overhead_size(uint64_t num_blocks, uint64_t num_chunks) {
+    return sizeof(mixed_array_t) + num_chunks * sizeof(uint64_t) + _get_type_map_size(num_blocks);
+}
+
+static void _set_mixed_pointers(mixed_array_t *mixed_array) {
+    mixed_array->chunk_offsets = (uint64_t*)(mixed_array + 1);       /* just after the header */
+    mixed_array->type_map      = (uint8_t*)(mixed_array->chunk_offsets + mixed_array->num_chunks);
+    mixed_array->payload       = mixed_array->type_map + _get_type_map_size(mixed_array->num_blocks);
+}
+
+static uint64_t _get_block_length(uint64_t num_elements, uint64_t block_index) {
+    const uint64_t start = block_index * MIXED_BLOCK_SIZE;
+    return (start + MIXED_BLOCK_SIZE <= num_elements) ? MIXED_BLOCK_SIZE : num_elements - start;
+}
+
+void free_mixed_array(mixed_array_t *mixed_array) {
+    if (!mixed_array) return;
+    free(mixed_array);
+}
+
+uint64_t get_mixed_array_size(const mixed_array_t *mixed_array) {
+    if (!mixed_array) return 0;
+    return _get_overhead_size(mixed_array->num_blocks, mixed_array->num_chunks) + mixed_array->payload_size;
+}
+
+mixed_array_t *load_mixed_array_from_buffer(const void *buffer, uint64_t buffer_size) {
+    if (!buffer || buffer_size < sizeof(mixed_array_t)) return NULL;
+
+    mixed_array_t *mixed_array = (mixed_array_t*)calloc(1, buffer_size);
+    if (!mixed_array) return NULL;
+
+    memcpy(mixed_array, buffer, buffer_size);
+    if (mixed_array->num_blocks != (mixed_array->num_elements + MIXED_BLOCK_SIZE - 1) / MIXED_BLOCK_SIZE ||
+        mixed_array->num_chunks != (mixed_array->num_blocks + MIXED_CHUNK_BLOCKS - 1) / MIXED_CHUNK_BLOCKS ||
+        get_mixed_array_size(mixed_array) > buffer_size) {
+        free(mixed_array);
+        return NULL;
+    }
+    _set_mixed_pointers(mixed_array);
+    return mixed_array;
+}
+
+uint8_t get_mixed_block_type(const mixed_array_t *mixed_array, uint64_t block_index) {
+    return (mixed_array->type_map[block_index / 4] >> (2 * (block_index % 4))) & 0x3;
+}
+
+/* ---- Block codecs ------------------------------------------------------------ */
+
+/* The MIXED_SPARSE_K largest magnitudes (lowest index on ties), written in ascending index order. */
+static void _select_top_k(const float *x, uint64_t n, uint8_t *indices) {
+    float top[MIXED_SPARSE_K];
+    uint8_t top_index[MIXED_SPARSE_K];
+    for (int k = 0; k < MIXED_SPARSE_K; ++k) {
+        top[k] = -1.0f;
+        top_index[k] = 0;
+    }
+
+    /* one pass keeping a descending top-k; strict comparisons keep the earlier index on ties */
+    for (uint64_t i = 0; i < n; ++i) {
+        const float v = fabsf(x[i]);
+        if (v <= top[MIXED_SPARSE_K - 1]) continue;
+        int k = MIXED_SPARSE_K - 1;
+        for (; k > 0 && v > top[k - 1]; --k) {
+            top[k] = top[k - 1];
+            top_index[k] = top_index[k - 1];
+        }
+        top[k] = v;
+        top_index[k] = (uint8_t)i;
+    }
+
+    uint32_t taken = 0;
+    for (int k = 0; k < MIXED_SPARSE_K; ++k) taken |= 1u << top_index[k];
+    for (uint64_t i = 0, k = 0; i < n; ++i) {
+        if ((taken >> i) & 1u) indices[k++] = (uint8_t)i;
+    }
+}
+
+/*
+ * The MIXED_SPARSE_K largest magnitudes, descending, without their indices: a branch-free
+ * insertion through a sorted register list. Enough to measure a sparse block, whose error
+ * depends only on the kept magnitudes.
+ */
+static void _top_k_magnitudes(const float *x, uint64_t n, float top[MIXED_SPARSE_K]) {
+    for (int k = 0; k < MIXED_SPARSE_K; ++k) top[k] = 0.0f;
+    for (uint64_t i = 0; i < n; ++i) {
+        float v = fabsf(x[i]);
+        for (int k = 0; k < MIXED_SPARSE_K; ++k) {
+            const float hi = (v > top[k]) ? v : top[k];
+            v = (v > top[k]) ? top[k] : v;
+            top[k] = hi;
+        }
+    }
+}
+
+/* Keeps the top MIXED_SPARSE_K values as int8 with one scale; returns the scale. */
+static float _quantize_sparse_block(const float *x, uint64_t n, uint8_t *indices, int8_t *q) {
+    _select_top_k(x, n, indices);
+
+    float abs_max = 0.0f;
+    for (int k = 0; k < MIXED_SPARSE_K; ++k) {
+        const float v = fabsf(x[indices[k]]);
+        abs_max = (v > abs_max) ? v : abs_max;
+    }
+    const float scale = (abs_max > 0.0f) ? (abs_max / 127.0f) : 0.0f;
+    const float inv_scale = (scale > 0.0f) ? (1.0f / scale) : 0.0f;
+    for (int k = 0; k < MIXED_SPARSE_K; ++k) {
+        q[k] = (int8_t)_clamp(_round_nearest(x[indices[k]] * inv_scale), -127.0f, 127.0f);
+    }
+    return scale;
+}
+
+/*
+ * Squared error of every candidate encoding of one block from cheap statistics of a single visit
+ * while it is in L1: energy, abs max and the top-k. The zero and sparse errors are exact. q4_0 /
+ * q8_0 are not trial-encoded; rounding to step d costs each element min(x^2, noise * d^2), since an
+ * element below half a step rounds to zero and any other is off by at most half a step. With
+ * MIXED_NOISE_BOUND that is an upper bound, with MIXED_NOISE_EXPECTED the usual uniform estimate.
+ */
+static void _measure_block(const float *x, uint64_t n, float noise, float sse[MIXED_BLOCK_TYPES]) {
+    float energy = 0.0f, abs_max = 0.0f;
+#pragma omp simd reduction(+:energy) reduction(max:abs_max)
+    for (uint64_t i = 0; i < n; ++i) {
+        const float v = fabsf(x[i]);
+        energy += v * v;
+        abs_max = (v > abs_max) ? v : abs_max;
+    }
+    sse[MIXED_BLOCK_ZERO] = energy;
+
+    /* a block no longer than k is cheaper as q8_0 anyway, and its unused slots would alias index 0 */
+    sse[MIXED_BLOCK_SPARSE] = INFINITY;
+    if (n > MIXED_SPARSE_K) {
+        /* the same arithmetic as _quantize_sparse_block on the magnitudes, which is sign-symmetric */
+        float top[MIXED_SPARSE_K];
+        _top_k_magnitudes(x, n, top);
+        const float scale = (top[0] > 0.0f) ? (top[0] / 127.0f) : 0.0f;
+        const float inv_scale = (scale > 0.0f) ? (1.0f / scale) : 0.0f;
+        float kept_energy = 0.0f, kept_error = 0.0f;
+        for (int k = 0; k < MIXED_SPARSE_K; ++k) {
+            const float v = top[k];
+            const float e = scale * _clamp(_round_nearest(v * inv_scale), -127.0f, 127.0f) - v;
+            kept_energy += v * v;
+            kept_error  += e * e;
+        }
+        const float dropped = energy - kept_energy;
+        sse[MIXED_BLOCK_SPARSE] = ((dropped > 0.0f) ? dropped : 0.0f) + kept_error;
+    }
+
+    const float step4 = abs_max / 7.0f, step8 = abs_max / 127.0f;
+    const float cap4 = noise * step4 * step4, cap8 = noise * step8 * step8;
+    float sse4 = 0.0f, sse8 = 0.0f;
+#pragma omp simd reduction(+:sse4, sse8)
+    for (uint64_t i = 0; i < n; ++i) {
+        const float v2 = x[i] * x[i];
+        sse4 += (v2 < cap4) ? v2 : cap4;
+        sse8 += (v2 < cap8) ? v2 : cap8;
+    }
+    sse[MIXED_BLOCK_Q4_0] = sse4;
+    sse[MIXED_BLOCK_Q8_0] = sse8;
+}
+
+/* The cheapest encoding within the error bound, q8_0 when none is. */
+static uint8_t _choose_for_bound(const float *sse, uint64_t n, double max_mse) {
+    for (uint8_t t = MIXED_BLOCK_ZERO; t < MIXED_BLOCK_Q8_0; ++t) {
+        if (sse[t] <= max_mse * (double)n) return t;
+    }
+    return MIXED_BLOCK_Q8_0;
+}
+
+/* One step along a block's rate-distortion hull: below multiplier lambda the block moves to block_type. */
+typedef struct {
+    double   lambda;            /* error saved per payload bit */
+    uint64_t block;
+    uint8_t  block_type;
+    uint8_t  reserved[7];
+} _hull_step_t;
+
+/* Steepest first; equal slopes in block order, so the result does not depend on the sort. */
+static int _hull_step_cmp(const void *a, const void *b) {
+    const _hull_step_t *sa = (const _hull_step_t *)a, *sb = (const _hull_step_t *)b;
+    if (sa->lambda != sb->lambda) return (sa->lambda > sb->lambda) ? -1 : 1;
+    return (sa->block > sb->block) - (sa->block < sb->block);
+}
+
+/*
+ * Lower convex hull of the block's (payload bits, error) points, walked from ZERO (no payload)
+ * towards the least error: each step goes to the point saving the most error per extra bit,
+ * the costliest of equally steep ones. Writes at most MIXED_BLOCK_TYPES - 1 steps.
+ */
+static uint64_t _get_hull_steps(const float *sse, uint64_t n, uint64_t block, _hull_step_t *steps) {
+    uint64_t num_steps = 0;
+    uint8_t current = MIXED_BLOCK_ZERO;
+    for (;;) {
+        const double current_bits = 8.0 * (double)_get_block_payload_size(current, n);
+        double best_slope = 0.0, best_bits = 0.0;
+        uint8_t best = current;
+        for (uint8_t t = MIXED_BLOCK_SPARSE; t < MIXED_BLOCK_TYPES; ++t) {
+            const double bits = 8.0 * (double)_get_block_payload_size(t, n);
+            if (bits <= current_bits || !(sse[t] < sse[current])) continue;
+            const double slope = ((double)sse[current] - (double)sse[t]) / (bits - current_bits);
+            if (slope > best_slope || (slope == best_slope && bits > best_bits)) {
+                best_slope = slope;
+                best_bits  = bits;
+                best       = t;
+            }
+        }
+        if (best == current) return num_steps;
+        steps[num_steps++] = (_hull_step_t){best_slope, block, best, {0}};
+        current = best;
+    }
+}
+
+/*
+ * Budget mode: the Lagrangian choice for the smallest multiplier that fits payload_budget. Every
+ * block's hull steps are collected and sorted once by slope, then taken steepest first until the
+ * next one would overflow the budget; O(blocks log blocks) instead of re-choosing every block per
+ * bisection step. Returns 1 if the step list cannot be allocated.
+ */
+static int _choose_for_budget(const float *sse, uint64_t num_elements, uint64_t num_blocks,
+                              uint64_t payload_budget, uint8_t *block_types) {
+    _hull_step_t *steps = (_hull_step_t*)malloc(num_blocks * (MIXED_BLOCK_TYPES - 1) * sizeof(_hull_step_t));
+    if (!steps) return 1;
+
+    uint64_t num_steps = 0;
+    for (uint64_t b = 0; b < num_blocks; ++b) {
+        block_types[b] = MIXED_BLOCK_ZERO;
+        num_steps += _get_hull_steps(sse + b * MIXED_BLOCK_TYPES, _get_block_length(num_elements, b), b,
+                                     steps + num_steps);
+    }
+    qsort(steps, num_steps, sizeof(_hull_step_t), _hull_step_cmp);
+
+    uint64_t payload_size = 0;
+    for (uint64_t i = 0; i < num_steps; ++i) {
+        const uint64_t b = steps[i].block;
+        const uint64_t n = _get_block_length(num_elements, b);
+        const uint64_t next_size = payload_size - _get_block_payload_size(block_types[b], n)
+                                 + _get_block_payload_size(steps[i].block_type, n);
+        if (next_size > payload_budget) break;
+        payload_size = next_size;
+        block_types[b] = steps[i].block_type;
+    }
+    free(steps);
+    return 0;
+}
+
+static void _encode_block(const float *x, uint64_t n, uint8_t block_type, uint8_t *dst) {
+    switch (block_type) {
+        case MIXED_BLOCK_SPARSE:
+            *(float *)dst = _quantize_sparse_block(x, n, dst + sizeof(float),
+                                                   (int8_t *)(dst + sizeof(float) + MIXED_SPARSE_K));
+            break;
+        case MIXED_BLOCK_Q4_0:
+            *(float *)dst = _quantize_q4_0_block(x, dst + sizeof(float), n, NULL);
+            break;
+        case MIXED_BLOCK_Q8_0:
+            *(float *)dst = _quantize_q8_0_block(x, (int8_t *)(dst + sizeof(float)), n, NULL);
+            break;
+        default: /* MIXED_BLOCK_ZERO has no payload */
+            break;
+    }
+}
+
+static void _decode_block(const uint8_t *src, uint8_t block_type, uint64_t n, float *y) {
+    switch (block_type) {
+        case MIXED_BLOCK_SPARSE: {
+            const float scale = *(const float *)src;
+            const uint8_t *indices = src + sizeof(float);
+            const int8_t *q = (const int8_t *)(src + sizeof(float) + MIXED_SPARSE_K);
+            memset(y, 0, n * sizeof(float));
+            for (int k = 0; k < MIXED_SPARSE_K; ++k) {
+                y[indices[k]] = scale * (float)q[k];
+            }
+            break;
+        }
+        case MIXED_BLOCK_Q4_0:
+            _dequantize_q4_0_block(src + sizeof(float), *(const float *)src, y, n);
+            break;
+        case MIXED_BLOCK_Q8_0:
+            _dequantize_q8_0_block((const int8_t *)(src + sizeof(float)), *(const float *)src, y, n);
+            break;
+        default: /* MIXED_BLOCK_ZERO */
+            memset(y, 0, n * sizeof(float));
+            break;
+    }
+}
+
+/* ---- Encode / decode ----------------------------------------------------------- */
+
+static int _check_config(const mixed_config_t *config) {
+    if (!config || !isfinite(config->bits_per_element) || config->bits_per_element < 0.0f) return 1;
+    if (config->bits_per_element == 0.0f && (!isfinite(config->max_mse) || config->max_mse < 0.0f)) return 1;
+    return 0;
+}
+
+static int _mixed_quantize(const float *float_array, uint64_t num_elements, const mixed_config_t *config,
+                           mixed_array_t **mixed_array, codec_metrics_t *metrics) {
+    const uint64_t num_blocks = (num_elements + MIXED_BLOCK_SIZE - 1) / MIXED_BLOCK_SIZE;
+    const uint64_t num_chunks = (num_blocks + MIXED_CHUNK_BLOCKS - 1) / MIXED_CHUNK_BLOCKS;
+
+    float *sse = (float*)malloc(num_blocks * MIXED_BLOCK_TYPES * sizeof(float));
+    uint8_t *block_types = (uint8_t*)malloc(num_blocks);
+    uint64_t *chunk_offsets = (uint64_t*)malloc(num_chunks * sizeof(uint64_t));
+    if (!sse || !block_types || !chunk_offsets) {
+        free(sse); free(block_types); free(chunk_offsets);
+        return 1;
+    }
+
+    /* ---- pass 1: per-block error estimate of every encoding ----------------- */
+    const int budget_mode = config->bits_per_element > 0.0f;
+    const float noise = budget_mode ? MIXED_NOISE_EXPECTED : MIXED_NOISE_BOUND;
+#pragma omp parallel for schedule(static)
+    for (uint64_t b = 0; b < num_blocks; ++b) {
+        _measure_block(float_array + b * MIXED_BLOCK_SIZE, _get_block_length(num_elements, b), noise,
+                       sse + b * MIXED_BLOCK_TYPES);
+    }
+
+    /* ---- choose, then lay out the payload chunk by chunk ------------------- */
+    int failed = 0;
+    if (budget_mode) {
+        const double budget_bytes = (double)config->bits_per_element * (double)num_elements / 8.0;
+        const double overhead = (double)_get_overhead_size(num_blocks, num_chunks);
+        const uint64_t payload_budget = (budget_bytes > overhead) ? (uint64_t)(budget_bytes - overhead) : 0;
+        failed = _choose_for_budget(sse, num_elements, num_blocks, payload_budget, block_types);
+    }
+
+#pragma omp parallel for schedule(static)
+    for (uint64_t c = 0; c < num_chunks; ++c) {
+        const uint64_t first_block = c * MIXED_CHUNK_BLOCKS;
+        const uint64_t end_block = (first_block + MIXED_CHUNK_BLOCKS < num_blocks) ? first_block + MIXED_CHUNK_BLOCKS : num_blocks;
+        uint64_t chunk_size = 0;
+        for (uint64_t b = first_block; b < end_block; ++b) {
+            const uint64_t n = _get_block_length(num_elements, b);
+            if (!budget_mode) block_types[b] = _choose_for_bound(sse + b * MIXED_BLOCK_TYPES, n, config->max_mse);
+            chunk_size += _get_block_payload_size(block_types[b], n);
+        }
+        chunk_offsets[c] = chunk_size;
+    }
+    free(sse);
+    if (failed) {
+        free(block_types); free(chunk_offsets);
+        return 1;
+    }
+
+    uint64_t payload_size = 0;
+    for (uint64_t c = 0; c < num_chunks; ++c) {
+        const uint64_t chunk_size = chunk_offsets[c];
+        chunk_offsets[c] = payload_size;
+        payload_size += chunk_size;
+    }
+
+    mixed_array_t *ma = (mixed_array_t*)calloc(1, _get_overhead_size(num_blocks, num_chunks) + payload_size);
+    if (!ma) {
+        free(block_types); free(chunk_offsets);
+        return 1;
+    }
+    ma->num_elements = num_elements;
+    ma->num_blocks   = num_blocks;
+    ma->num_chunks   = num_chunks;
+    ma->payload_size = payload_size;
+    _set_mixed_pointers(ma);
+    memcpy(ma->chunk_offsets, chunk_offsets, num_chunks * sizeof(uint64_t));
+    free(chunk_offsets);
+
+    for (uint64_t b = 0; b < num_blocks; ++b) {
+        ma->type_map[b / 4] |= (uint8_t)(block_types[b] << (2 * (b % 4)));
+        ma->block_counts[block_types[b]]++;
+    }
+
+    /* ---- pass 2: encode, measuring the real error on the way --------------- */
+    double sum_abs = 0.0, sum_sq = 0.0, sum_signal = 0.0, max_abs = 0.0;
+
+#pragma omp parallel for reduction(+:sum_abs, sum_sq, sum_signal) reduction(max:max_abs) schedule(static)
+    for (uint64_t c = 0; c < num_chunks; ++c) {
+        const uint64_t first_block = c * MIXED_CHUNK_BLOCKS;
+        const uint64_t end_block = (first_block + MIXED_CHUNK_BLOCKS < num_blocks) ? first_block + MIXED_CHUNK_BLOCKS : num_blocks;
+        uint64_t offset = ma->chunk_offsets[c];
+
+        for (uint64_t b = first_block; b < end_block; ++b) {
+            const uint64_t n = _get_block_length(num_elements, b);
+            const float *x = float_array + b * MIXED_BLOCK_SIZE;
+            _encode_block(x, n, block_types[b], ma->payload + offset);
+
+            if (metrics) {
+                float y[MIXED_BLOCK_SIZE];
+                _decode_block(ma->payload + offset, block_types[b], n, y);
+                for (uint64_t i = 0; i < n; ++i) {
+                    const double e  = (double)y[i] - (double)x[i];
+                    const double ae = fabs(e);
+                    sum_abs    += ae;
+                    sum_sq     += e * e;
+                    sum_signal += (double)x[i] * x[i];
+                    if (ae > max_abs) max_abs = ae;
+                }
+            }
+            offset += _get_block_payload_size(block_types[b], n);
+        }
+    }
+    free(block_types);
+
+    if (metrics) codec_metrics_finalize(sum_abs, sum_sq, max_abs, sum_signal, num_elements, metrics);
+    *mixed_array = ma;
+    return 0;
+}
+
+int mixed_quantize(const float *float_array,
+                   uint64_t num_elements,
+                   const mixed_config_t *config,
+                   mixed_array_t **mixed_array,
+                   codec_metrics_t *metrics) {
+    if (!float_array || num_elements == 0 || !mixed_array || *mixed_array || _check_config(config)) return 1;
+
+    CODEC_PROFILE_BEGIN(CODEC_OP_QUANTIZE, MIXED_PROFILE_FORMAT, num_elements);
+    int ret = _mixed_quantize(float_array, num_elements, config, mixed_array, metrics);
+    CODEC_PROFILE_END(CODEC_OP_QUANTIZE, MIXED_PROFILE_FORMAT, num_elements,
+                      num_elements * sizeof(float),
+                      ret ? 0 : get_mixed_array_size(*mixed_array));
+    return ret;
+}
+
+int mixed_dequantize(const mixed_array_t *mixed_array,
+                     float *float_array) {
+    if (!mixed_array || !float_array) return 1;
+
+    CODEC_PROFILE_BEGIN(CODEC_OP_DEQUANTIZE, MIXED_PROFILE_FORMAT, mixed_array->num_elements);
+
+#pragma omp parallel for schedule(static)
+    for (uint64_t c = 0; c < mixed_array->num_chunks; ++c) {
+        const uint64_t first_block = c * MIXED_CHUNK_BLOCKS;
+        const uint64_t end_block = (first_block + MIXED_CHUNK_BLOCKS < mixed_array->num_blocks)
+                                     ? first_block + MIXED_CHUNK_BLOCKS
+                                     : mixed_array->num_blocks;
+        uint64_t offset = mixed_array->chunk_offsets[c];
+
+        for (uint64_t b = first_block; b < end_block; ++b) {
+            const uint64_t n = _get_block_length(mixed_array->num_elements, b);
+            const uint8_t block_type = get_mixed_block_type(mixed_array, b);
+            _decode_block(mixed_array->payload + offset, block_type, n, float_array + b * MIXED_BLOCK_SIZE);
+            offset += _get_block_payload_size(block_type, n);
+        }
+    }
+
+    CODEC_PROFILE_END(CODEC_OP_DEQUANTIZE, MIXED_PROFILE_FORMAT, mixed_array->num_elements,
+                      get_mixed_array_size(mixed_array), mixed_array->num_elements * sizeof(float));
+    return 0;
+}
@@ -0,0 +1,246 @@
+#include "autotune.h"
+#include "quantization.h"
+#include "sparsity.h"
+#include "random.h"
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <omp.h>
+
+#define AUTOTUNE_SEED 12345
+
+static const uint32_t _quantize_chunks[] = {16, 64, 256};     /* blocks per scheduling step */
+static const uint32_t _compress_chunks[] = {1, 4, 16};        /* tokens per scheduling step */
+
+static _Atomic(const autotune_profile_t *) _active_profile;
+
+/* candidate forced by autotune_run on the benchmarking thread only */
+static _Thread_local const autotune_config_t *_forced_config;
+
+/* ---- Lookup ------------------------------------------------------------------ */
+
+void autotune_set_profile(const autotune_profile_t *profile) {
+    atomic_store(&_active_profile, profile);
+}
+
+void autotune_apply(uint8_t op, uint8_t format, uint64_t num_elements, uint16_t num_features,
+                    uint16_t num_kept, autotune_config_t *config) {
+    if (_forced_config) {
+        *config = *_forced_config;
+        return;
+    }
+
+    const autotune_profile_t *profile = atomic_load(&_active_profile);
+    if (!profile) return;
+
+    const autotune_entry_t *best = NULL;
+    double best_distance = INFINITY;
+    for (uint64_t i = 0; i < profile->num_entries; ++i) {
+        const autotune_entry_t *entry = &profile->entries[i];
+        if (!entry->tuned || entry->op != op || entry->format != format) continue;
+        if (entry->num_elements == num_elements && entry->num_features == num_features && entry->num_kept == num_kept) {
+            best = entry;
+            break;
+        }
+        /* nearest in log size: a 2-token call behaves like the tuned 1-token one, not the prefill */
+        const double distance = fabs(log((double)entry->num_elements / (double)num_elements));
+        if (distance < best_distance) {
+            best = entry;
+            best_distance = distance;
+        }
+    }
+    if (!best) return;
+
+    *config = best->config;
+    const uint32_t max_threads = (uint32_t)omp_get_max_threads();
+    if (config->num_threads > max_threads) config->num_threads = max_threads;
+}
+
+/* ---- Registration ---------------------------------------------------------- */
+
+static int _register(autotune_profile_t *profile, uint8_t op, uint8_t format, uint64_t num_elements,
+                     uint16_t num_features, uint16_t num_kept) {
+    for (uint64_t i = 0; i < profile->num_entries; ++i) {
+        const autotune_entry_t *entry = &profile->entries[i];
+        if (entry->op == op && entry->format == format && entry->num_elements == num_elements &&
+            entry->num_features == num_features && entry->num_kept == num_kept) return 0;
+    }
+    if (profile->num_entries == AUTOTUNE_MAX_SHAPES) return 1;
+
+    autotune_entry_t *entry = &profile->entries[profile->num_entries++];
+    memset(entry, 0, sizeof(*entry));
+    entry->op           = op;
+    entry->format       = format;
+    entry->num_elements = num_elements;
+    entry->num_features = num_features;
+    entry->num_kept     = num_kept;
+    return 0;
+}
+
+int autotune_register_quantize(autotune_profile_t *profile, uint8_t quantized_type, uint64_t num_elements) {
+    if (!profile || quantized_type >= QUANTIZED_TYPE_COUNT || num_elements == 0) return 1;
+    return _register(profile, AUTOTUNE_OP_QUANTIZE, quantized_type, num_elements, 0, 0);
+}
+
+int autotune_register_compress(autotune_profile_t *profile, uint16_t num_tokens, uint16_t num_features,
+                               float sparse_ratio) {
+    if (!profile || !num_tokens || !num_features || sparse_ratio < 0.0f || sparse_ratio > 1.0f) return 1;
+    return _register(profile, AUTOTUNE_OP_COMPRESS, 0, (uint64_t)num_tokens * num_features, num_features,
+                     get_num_sparse_features(num_features, sparse_ratio));
+}
+
+/* ---- Benchmarking ---------------------------------------------------------- */
+
+/*
+ * Best-of-repetitions time of one codec call on the entry's shape, INFINITY on failure. The output
+ * is allocated once, untimed, and reused, so only the encode kernel and its schedule are measured.
+ */
+static double _time_entry(const autotune_entry_t *entry, const float *data, uint32_t repetitions) {
+    quantized_array_t *qa = NULL;
+    sparse_array_t *sa = NULL;
+    int failed;
+    if (entry->op == AUTOTUNE_OP_QUANTIZE) {
+        failed = quantize(data, entry->num_elements, entry->format, &qa);
+    } else {
+        const uint16_t num_tokens = (uint16_t)(entry->num_elements / entry->num_features);
+        sa = allocate_sparse_array(num_tokens, entry->num_features,
+                                   (float)entry->num_kept / (float)entry->num_features);
+        failed = !sa || sa->num_sparse_features != entry->num_kept;
+    }
+
+    double best = INFINITY;
+    for (uint32_t r = 0; !failed && r < repetitions; ++r) {
+        const double t0 = omp_get_wtime();
+        failed = qa ? quantize_into(data, qa, NULL) : compress_into(data, sa, NULL);
+        const double t = omp_get_wtime() - t0;
+        if (t < best) best = t;
+    }
+    free_quantized_array(qa);
+    free_sparse_array(sa);
+    return failed ? INFINITY : best;
+}
+
+static int _tune_entry(autotune_entry_t *entry, uint32_t repetitions) {
+    const random_config_t config = {.distribution = RANDOM_NORMAL, .mean = 0.0f, .stddev = 1.0f};
+    float *data = gen_random_float_buffer(entry->num_elements, &config, AUTOTUNE_SEED);
+    if (!data) return 1;
+
+    const int is_quantize = entry->op == AUTOTUNE_OP_QUANTIZE;
+    const uint32_t *chunks = is_quantize ? _quantize_chunks : _compress_chunks;
+    const size_t num_chunks = is_quantize ? sizeof(_quantize_chunks) / sizeof(_quantize_chunks[0])
+                                          : sizeof(_compress_chunks) / sizeof(_compress_chunks[0]);
+    const uint8_t num_kernels = is_quantize ? 1 : 2;
+    const uint32_t max_threads = (uint32_t)omp_get_max_threads();
+
+    /* 1, 2, 4, ... and the maximum itself */
+    uint32_t thread_counts[33];
+    size_t num_thread_counts = 0;
+    for (uint32_t threads = 1; threads < max_threads && num_thread_counts < 32; threads *= 2) {
+        thread_counts[num_thread_counts++] = threads;
+    }
+    thread_counts[num_thread_counts++] = max_threads;
+
+    double best_time = INFINITY;
+    autotune_config_t candidate;
+    for (size_t t = 0; t < num_thread_counts; ++t) {
+        for (size_t c = 0; c < num_chunks; ++c) {
+            for (uint8_t kernel = 0; kernel < num_kernels; ++kernel) {
+                candidate.num_threads = thread_counts[t];
+                candidate.chunk       = chunks[c];
+                candidate.kernel      = kernel;
+
+                _forced_config = &candidate;
+                const double elapsed = _time_entry(entry, data, repetitions);
+                _forced_config = NULL;
+
+                if (elapsed < best_time) {
+                    best_time     = elapsed;
+                    entry->config = candidate;
+                }
+            }
+        }
+    }
+    free(data);
+
+    if (best_time == INFINITY) return 1;
+    entry->tuned   = 1;
+    entry->time_us = best_time * 1e6;
+    return 0;
+}
+
+int autotune_run(autotune_profile_t *profile, uint32_t repetitions) {
+    if (!profile || repetitions == 0) return 1;
+    for (uint64_t i = 0; i < profile->num_entries; ++i) {
+        if (_tune_entry(&profile->entries[i], repetitions)) return 1;
+    }
+    return 0;
+}
+
+/* ---- Profile files ------------------------------------------------------- */
+
+static const char *_op_names[] = {"quantize", "compress"};
+
+int autotune_save_profile(const autotune_profile_t *profile, const char *path) {
+    if (!profile || !path) return 1;
+
+    FILE *file = fopen(path, "w");
+    if (!file) return 1;
+
+    int failed = fprintf(file, "# op format num_elements num_features num_kept threads chunk kernel time_us\n") < 0;
+    for (uint64_t i = 0; !failed && i < profile->num_entries; ++i) {
+        const autotune_entry_t *e = &profile->entries[i];
+        if (!e->tuned) continue;
+        failed = fprintf(file, "%s %u %" PRIu64 " %u %u %u %u %u %.3f\n", _op_names[e->op], e->format, e->num_elements,
+                         e->num_features, e->num_kept, e->config.num_threads, e->config.chunk, e->config.kernel,
+                         e->time_us) < 0;
+    }
+    failed |= (fclose(file) != 0);
+    return failed;
+}
+
+int autotune_load_profile(autotune_profile_t *profile, const char *path) {
+    if (!profile || !path) return 1;
+
+    FILE *file = fopen(path, "r");
+    if (!file) return 1;
+
+    memset(profile, 0, sizeof(*profile));
+    char line[256];
+    int failed = 0;
+    while (!failed && fgets(line, sizeof(line), file)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+
+        char op_name[16];
+        unsigned format, num_features, num_kept, threads, chunk, kernel;
+        uint64_t num_elements;
+        double time_us;
+        if (sscanf(line, "%15s %u %" SCNu64 " %u %u %u %u %u %lf", op_name, &format, &num_elements, &num_features,
+                   &num_kept, &threads, &chunk, &kernel, &time_us) != 9) {
+            failed = 1;
+            break;
+        }
+
+        uint8_t op;
+        if (strcmp(op_name, _op_names[AUTOTUNE_OP_QUANTIZE]) == 0)      op = AUTOTUNE_OP_QUANTIZE;
+        else if (strcmp(op_name, _op_names[AUTOTUNE_OP_COMPRESS]) == 0) op = AUTOTUNE_OP_COMPRESS;
+        else { failed = 1; break; }
+
+        const uint64_t num_entries = profile->num_entries;
+        failed = format > UINT8_MAX || num_features > UINT16_MAX || num_kept > num_features ||
+                 num_elements == 0 || threads == 0 || chunk == 0 || kernel > AUTOTUNE_TOPK_SELECT ||
+                 (op == AUTOTUNE_OP_COMPRESS && (num_features == 0 || num_elements % num_features)) ||
+                 _register(profile, op, (uint8_t)format, num_elements, (uint16_t)num_features, (uint16_t)num_kept) ||
+                 profile->num_entries == num_entries;    /* duplicate line */
+        if (failed) break;
+
+        autotune_entry_t *entry = &profile->entries[profile->num_entries - 1];
+        entry->tuned              = 1;
+        entry->config.num_threads = threads;
+        entry->config.chunk       = chunk;
+        entry->config.kernel      = (uint8_t)kernel;
+        entry->time_us            = time_us;
+    }
+    fclose(file);
+    return failed;
+}
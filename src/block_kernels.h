@@ -0,0 +1,150 @@
+#ifndef BLOCK_KERNELS_H
+#define BLOCK_KERNELS_H
+
+#include <stdint.h>
+#include <math.h>
+
+/*
+ * Shared q8_0 / q4_0 block primitives: the quantized arrays, the per-token rows and the
+ * mixed-format encoder all encode blocks through these, so every codec rounds identically.
+ * Everything is static inline; the header sits next to the sources, outside include/, so only the
+ * library's own translation units can reach it.
+ */
+
+typedef struct {
+    double sum_abs;
+    double sum_sq;
+    double sum_signal;
+    double max_abs;
+} _error_sums_t;
+
+/* round to nearest even for |v| < 2^22; same result as lrintf() but it vectorizes */
+static inline float _round_nearest(float v) {
+    return (v + 12582912.0f) - 12582912.0f;
+}
+
+static inline float _clamp(float v, float lo, float hi) {
+    v = (v < lo) ? lo : v;
+    return (v > hi) ? hi : v;
+}
+
+static inline float _block_abs_max(const float *x, uint64_t n) {
+    float abs_max = 0.0f;
+#pragma omp simd reduction(max:abs_max)
+    for (uint64_t i = 0; i < n; ++i) {
+        const float v = fabsf(x[i]);
+        abs_max = (v > abs_max) ? v : abs_max;
+    }
+    return abs_max;
+}
+
+static inline void _add_block_error(_error_sums_t *sums, float block_abs, float block_sq,
+                                    float block_signal, float block_max) {
+    sums->sum_abs    += block_abs;
+    sums->sum_sq     += block_sq;
+    sums->sum_signal += block_signal;
+    if (block_max > sums->max_abs) sums->max_abs = block_max;
+}
+
+/* Quantizes n elements of one q8_0 block and returns its scale; sums may be NULL. */
+static inline float _quantize_q8_0_block(const float *restrict x, int8_t *restrict q,
+                                         uint64_t n, _error_sums_t *sums) {
+    /* 1) find max‑abs in this block */
+    const float abs_max = _block_abs_max(x, n);
+
+    /* 2) compute scale */
+    const float scale = (abs_max > 0.0f) ? (abs_max / 127.0f) : 0.0f;
+    const float inv_scale = (scale > 0.0f) ? (1.0f / scale) : 0.0f;
+
+    /* 3) quantise */
+#pragma omp simd
+    for (uint64_t i = 0; i < n; ++i) {
+        q[i] = (int8_t)_clamp(_round_nearest(x[i] * inv_scale), -127.0f, 127.0f);
+    }
+
+    /* 4) error statistics while the block is still in cache */
+    if (sums) {
+        float block_abs = 0.0f, block_sq = 0.0f, block_signal = 0.0f, block_max = 0.0f;
+#pragma omp simd reduction(+:block_abs, block_sq, block_signal) reduction(max:block_max)
+        for (uint64_t i = 0; i < n; ++i) {
+            const float e  = scale * (float)q[i] - x[i];
+            const float ae = fabsf(e);
+            block_abs    += ae;
+            block_sq     += e * e;
+            block_signal += x[i] * x[i];
+            block_max     = (ae > block_max) ? ae : block_max;
+        }
+        _add_block_error(sums, block_abs, block_sq, block_signal, block_max);
+    }
+    return scale;
+}
+
+/*
+ * Quantizes n elements of one q4_0 block into q (the byte holding the block's first element)
+ * and returns its scale. Even elements go to the high nibble; blocks always start on an even
+ * element, so a block never shares a byte with its neighbour.
+ */
+static inline float _quantize_q4_0_block(const float *restrict x, uint8_t *restrict q,
+                                         uint64_t n, _error_sums_t *sums) {
+    /* 1) find max‑abs in this block */
+    const float abs_max = _block_abs_max(x, n);
+
+    /* 2) compute scale */
+    const float scale = (abs_max > 0.0f) ? (abs_max / 7.0f) : 0.0f;
+    const float inv_scale = (scale > 0.0f) ? (1.0f / scale) : 0.0f;
+
+    /* 3) quantise, two elements per byte */
+    const uint64_t num_pairs = n / 2;
+#pragma omp simd
+    for (uint64_t p = 0; p < num_pairs; ++p) {
+        const int hi = (int)_clamp(_round_nearest(x[2 * p] * inv_scale), -7.0f, 7.0f);
+        const int lo = (int)_clamp(_round_nearest(x[2 * p + 1] * inv_scale), -7.0f, 7.0f);
+        q[p] = (uint8_t)(((hi & 0x0F) << 4) | (lo & 0x0F));
+    }
+    if (n % 2) {
+        const int hi = (int)_clamp(_round_nearest(x[n - 1] * inv_scale), -7.0f, 7.0f);
+        q[num_pairs] = (uint8_t)((hi & 0x0F) << 4);
+    }
+
+    /* 4) error statistics while the block is still in cache */
+    if (sums) {
+        float block_abs = 0.0f, block_sq = 0.0f, block_signal = 0.0f, block_max = 0.0f;
+#pragma omp simd reduction(+:block_abs, block_sq, block_signal) reduction(max:block_max)
+        for (uint64_t i = 0; i < n; ++i) {
+            const uint8_t packed_qi = q[i / 2];
+            const int8_t signed_qi = (i % 2 == 0) ? (int8_t)((int8_t)packed_qi >> 4)
+                                                  : (int8_t)((int8_t)(packed_qi << 4) >> 4);
+            const float e  = scale * (float)signed_qi - x[i];
+            const float ae = fabsf(e);
+            block_abs    += ae;
+            block_sq     += e * e;
+            block_signal += x[i] * x[i];
+            block_max     = (ae > block_max) ? ae : block_max;
+        }
+        _add_block_error(sums, block_abs, block_sq, block_signal, block_max);
+    }
+    return scale;
+}
+
+static inline void _dequantize_q8_0_block(const int8_t *restrict q, float scale,
+                                          float *restrict y, uint64_t n) {
+#pragma omp simd
+    for (uint64_t i = 0; i < n; ++i) {
+        y[i] = scale * (float)q[i];
+    }
+}
+
+static inline void _dequantize_q4_0_block(const uint8_t *restrict q, float scale,
+                                          float *restrict y, uint64_t n) {
+    const uint64_t num_pairs = n / 2;
+#pragma omp simd
+    for (uint64_t p = 0; p < num_pairs; ++p) {
+        y[2 * p]     = scale * (float)((int8_t)q[p] >> 4);
+        y[2 * p + 1] = scale * (float)((int8_t)(q[p] << 4) >> 4);
+    }
+    if (n % 2) {
+        y[n - 1] = scale * (float)((int8_t)q[num_pairs] >> 4);
+    }
+}
+
+#endif
@@ -0,0 +1,306 @@
+#define _POSIX_C_SOURCE 200809L     /* fileno, fseeko, mmap */
+
+#include "container.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#define CONTAINER_INITIAL_CAPACITY 16
+
+/* ---- Name table ---------------------------------------------------------- */
+
+/* FNV-1a */
+static uint64_t _hash_name(const char *name) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const unsigned char *c = (const unsigned char *)name; *c; ++c) {
+        hash ^= *c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/* Open addressing with linear probing; slots hold entry index + 1, so 0 marks an empty slot. */
+static void _insert_name(uint64_t *slots, uint64_t num_slots, const container_entry_t *entries, uint64_t i) {
+    uint64_t slot = _hash_name(entries[i].name) & (num_slots - 1);
+    while (slots[slot]) slot = (slot + 1) & (num_slots - 1);
+    slots[slot] = i + 1;
+}
+
+static const container_entry_t *_find_name(const uint64_t *slots, uint64_t num_slots,
+                                           const container_entry_t *entries, const char *name) {
+    uint64_t slot = _hash_name(name) & (num_slots - 1);
+    while (slots[slot]) {
+        const container_entry_t *entry = &entries[slots[slot] - 1];
+        if (strcmp(entry->name, name) == 0) return entry;
+        slot = (slot + 1) & (num_slots - 1);
+    }
+    return NULL;
+}
+
+/* ---- Writing ------------------------------------------------------------- */
+
+static int _write_padding(container_writer_t *writer) {
+    static const uint8_t zeros[CONTAINER_ALIGNMENT] = {0};
+    const uint64_t pad = (CONTAINER_ALIGNMENT - writer->offset % CONTAINER_ALIGNMENT) % CONTAINER_ALIGNMENT;
+    if (pad && fwrite(zeros, 1, pad, writer->file) != pad) {
+        writer->failed = 1;
+        return 1;
+    }
+    writer->offset += pad;
+    return 0;
+}
+
+container_writer_t *create_container(const char *path) {
+    if (!path) return NULL;
+
+    container_writer_t *writer = (container_writer_t*)calloc(1, sizeof(container_writer_t));
+    if (!writer) return NULL;
+
+    writer->entries = (container_entry_t*)calloc(CONTAINER_INITIAL_CAPACITY, sizeof(container_entry_t));
+    writer->slots = (uint64_t*)calloc(2 * CONTAINER_INITIAL_CAPACITY, sizeof(uint64_t));
+    writer->file = fopen(path, "wb");
+    if (!writer->entries || !writer->slots || !writer->file) {
+        if (writer->file) fclose(writer->file);
+        free(writer->entries);
+        free(writer->slots);
+        free(writer);
+        return NULL;
+    }
+    writer->capacity  = CONTAINER_INITIAL_CAPACITY;
+    writer->num_slots = 2 * CONTAINER_INITIAL_CAPACITY;
+
+    /* index_offset stays 0 until finalize_container patches it */
+    container_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CONTAINER_MAGIC, sizeof(header.magic));
+    header.version   = CONTAINER_VERSION;
+    header.alignment = CONTAINER_ALIGNMENT;
+    if (fwrite(&header, sizeof(header), 1, writer->file) != 1) {
+        fclose(writer->file);
+        free(writer->entries);
+        free(writer->slots);
+        free(writer);
+        return NULL;
+    }
+    writer->offset = sizeof(header);
+    return writer;
+}
+
+/* Validates the name, reserves an index entry and aligns the file for the payload that follows. */
+static container_entry_t *_begin_entry(container_writer_t *writer, const char *name, uint8_t codec,
+                                       const uint64_t *shape, uint8_t num_dims, uint64_t size) {
+    if (!writer || writer->failed || !name || !size || num_dims > CONTAINER_MAX_DIMS || (num_dims && !shape))
+        return NULL;
+
+    const size_t name_length = strlen(name);
+    if (!name_length || name_length >= CONTAINER_MAX_NAME) return NULL;
+    if (_find_name(writer->slots, writer->num_slots, writer->entries, name)) return NULL; /* duplicate name */
+
+    if (writer->num_tensors == writer->capacity) {
+        /* the hash table doubles with the entries, staying at most half full */
+        const uint64_t new_capacity = writer->capacity * 2;
+        container_entry_t *entries = (container_entry_t*)realloc(writer->entries, new_capacity * sizeof(container_entry_t));
+        if (!entries) return NULL;
+        writer->entries = entries;
+
+        uint64_t *slots = (uint64_t*)calloc(2 * new_capacity, sizeof(uint64_t));
+        if (!slots) return NULL;
+        for (uint64_t i = 0; i < writer->num_tensors; ++i) _insert_name(slots, 2 * new_capacity, writer->entries, i);
+        free(writer->slots);
+        writer->slots     = slots;
+        writer->num_slots = 2 * new_capacity;
+        writer->capacity  = new_capacity;
+    }
+    if (_write_padding(writer)) return NULL;
+
+    container_entry_t *entry = &writer->entries[writer->num_tensors];
+    memset(entry, 0, sizeof(*entry));
+    memcpy(entry->name, name, name_length);
+    entry->codec    = codec;
+    entry->num_dims = num_dims;
+    for (uint8_t d = 0; d < num_dims; ++d) entry->shape[d] = shape[d];
+    entry->offset   = writer->offset;
+    entry->size     = size;
+    return entry;
+}
+
+/* Writes a codec struct with its pointer fields cleared, followed by the data it points to. */
+static int _write_payload(container_writer_t *writer, const void *header, size_t header_size,
+                          const void *data, uint64_t data_size) {
+    if (fwrite(header, header_size, 1, writer->file) != 1 ||
+        (data_size && fwrite(data, 1, data_size, writer->file) != data_size)) {
+        writer->failed = 1;
+        return 1;
+    }
+    writer->offset += header_size + data_size;
+    _insert_name(writer->slots, writer->num_slots, writer->entries, writer->num_tensors);
+    writer->num_tensors++;
+    return 0;
+}
+
+int append_quantized_to_container(container_writer_t *writer,
+                                  const char *name,
+                                  const uint64_t *shape,
+                                  uint8_t num_dims,
+                                  const quantized_array_t *quantized_array) {
+    if (!quantized_array) return 1;
+
+    const uint64_t size = (uint64_t)get_quantized_array_size(quantized_array);
+    container_entry_t *entry = _begin_entry(writer, name, CONTAINER_CODEC_QUANTIZED, shape, num_dims, size);
+    if (!entry) return 1;
+    entry->quantized_type = quantized_array->quantized_type;
+
+    /* scales and data are contiguous for arrays from allocate_*, load_* and view_* */
+    quantized_array_t header = *quantized_array;
+    header.scales = NULL;
+    header.data   = NULL;
+    return _write_payload(writer, &header, sizeof(header), quantized_array->scales, size - sizeof(header));
+}
+
+int append_sparse_to_container(container_writer_t *writer,
+                               const char *name,
+                               const sparse_array_t *sparse_array) {
+    if (!sparse_array) return 1;
+
+    const uint64_t size = get_sparse_array_size(sparse_array);
+    const uint64_t shape[2] = {sparse_array->num_tokens, sparse_array->num_features};
+    if (!_begin_entry(writer, name, CONTAINER_CODEC_SPARSE, shape, 2, size)) return 1;
+
+    /* sparse_indices and values are contiguous for arrays from allocate_*, load_* and view_* */
+    sparse_array_t header = *sparse_array;
+    header.sparse_indices = NULL;
+    header.values         = NULL;
+    return _write_payload(writer, &header, sizeof(header), sparse_array->sparse_indices, size - sizeof(header));
+}
+
+int finalize_container(container_writer_t *writer) {
+    if (!writer) return 1;
+
+    int failed = writer->failed || _write_padding(writer);
+    const uint64_t index_offset = writer->offset;
+    if (!failed && writer->num_tensors &&
+        fwrite(writer->entries, sizeof(container_entry_t), writer->num_tensors, writer->file) != writer->num_tensors)
+        failed = 1;
+
+    /* patch the header last: until now a reader sees an unfinished file */
+    if (!failed) {
+        container_header_t header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, CONTAINER_MAGIC, sizeof(header.magic));
+        header.version      = CONTAINER_VERSION;
+        header.alignment    = CONTAINER_ALIGNMENT;
+        header.num_tensors  = writer->num_tensors;
+        header.index_offset = index_offset;
+        failed = fseeko(writer->file, 0, SEEK_SET) != 0
+              || fwrite(&header, sizeof(header), 1, writer->file) != 1;
+    }
+
+    failed |= (fclose(writer->file) != 0);
+    free(writer->entries);
+    free(writer->slots);
+    free(writer);
+    return failed;
+}
+
+/* ---- Reading ------------------------------------------------------------- */
+
+static int _build_name_table(container_reader_t *reader) {
+    uint64_t num_slots = 1;
+    while (num_slots < 2 * reader->num_tensors) num_slots *= 2;
+
+    reader->slots = (uint64_t*)calloc(num_slots, sizeof(uint64_t));
+    if (!reader->slots) return 1;
+    reader->num_slots = num_slots;
+
+    for (uint64_t i = 0; i < reader->num_tensors; ++i) {
+        if (memchr(reader->entries[i].name, '\0', CONTAINER_MAX_NAME) == NULL) return 1; /* unterminated name */
+        _insert_name(reader->slots, num_slots, reader->entries, i);
+    }
+    return 0;
+}
+
+/* Checks the header and that the index and every payload lie inside the file. */
+static int _validate_container(const uint8_t *base, uint64_t file_size) {
+    if (file_size < sizeof(container_header_t)) return 1;
+
+    container_header_t header;
+    memcpy(&header, base, sizeof(header));
+    if (memcmp(header.magic, CONTAINER_MAGIC, sizeof(header.magic)) != 0) return 1;
+    if (header.version != CONTAINER_VERSION || header.alignment != CONTAINER_ALIGNMENT) return 1;
+    if (!header.index_offset || header.index_offset % CONTAINER_ALIGNMENT) return 1; /* writer never finished */
+    if (header.index_offset > file_size ||
+        header.num_tensors > (file_size - header.index_offset) / sizeof(container_entry_t)) return 1;
+
+    const container_entry_t *entries = (const container_entry_t *)(base + header.index_offset);
+    for (uint64_t i = 0; i < header.num_tensors; ++i) {
+        if (entries[i].offset % CONTAINER_ALIGNMENT || entries[i].offset > header.index_offset ||
+            entries[i].size > header.index_offset - entries[i].offset) return 1;
+    }
+    return 0;
+}
+
+container_reader_t *open_container(const char *path) {
+    if (!path) return NULL;
+
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(container_header_t)) {
+        close(fd);
+        return NULL;
+    }
+
+    void *mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);      /* the mapping keeps the file referenced */
+    if (mapping == MAP_FAILED) return NULL;
+
+    const uint8_t *base = (const uint8_t *)mapping;
+    container_reader_t *reader = NULL;
+    if (_validate_container(base, (uint64_t)st.st_size) == 0)
+        reader = (container_reader_t*)calloc(1, sizeof(container_reader_t));
+    if (!reader) {
+        munmap(mapping, (size_t)st.st_size);
+        return NULL;
+    }
+
+    const container_header_t *header = (const container_header_t *)base;
+    reader->base        = base;
+    reader->file_size   = (uint64_t)st.st_size;
+    reader->num_tensors = header->num_tensors;
+    reader->entries     = (const container_entry_t *)(base + header->index_offset);
+    if (_build_name_table(reader)) {
+        close_container(reader);
+        return NULL;
+    }
+    return reader;
+}
+
+void close_container(container_reader_t *reader) {
+    if (!reader) return;
+    munmap((void *)reader->base, (size_t)reader->file_size);
+    free(reader->slots);
+    free(reader);
+}
+
+const container_entry_t *find_in_container(const container_reader_t *reader, const char *name) {
+    if (!reader || !name) return NULL;
+    return _find_name(reader->slots, reader->num_slots, reader->entries, name);
+}
+
+int view_quantized_from_container(const container_reader_t *reader,
+                                  const container_entry_t *entry,
+                                  quantized_array_t *view) {
+    if (!reader || !entry || !view || entry->codec != CONTAINER_CODEC_QUANTIZED) return 1;
+    return view_quantized_array_from_buffer(reader->base + entry->offset, entry->size, view);
+}
+
+int view_sparse_from_container(const container_reader_t *reader,
+                               const container_entry_t *entry,
+                               sparse_array_t *view) {
+    if (!reader || !entry || !view || entry->codec != CONTAINER_CODEC_SPARSE) return 1;
+    return view_sparse_array_from_buffer(reader->base + entry->offset, entry->size, view);
+}
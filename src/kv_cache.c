@@ -0,0 +1,107 @@
+#include "kv_cache.h"
+
+quantized_cache_t *allocate_quantized_cache(uint16_t num_features,
+                                            uint8_t quantized_type,
+                                            uint16_t group_size,
+                                            uint16_t tokens_per_page) {
+    if (!num_features || !tokens_per_page || quantized_type > 1) return NULL;
+
+    /* validate the row format once with a throw-away single-token page */
+    token_quantized_array_t *probe = allocate_token_quantized_array(1, num_features, quantized_type, group_size);
+    if (!probe) return NULL;
+    free_token_quantized_array(probe);
+
+    quantized_cache_t *cache = (quantized_cache_t*)calloc(1, sizeof(quantized_cache_t));
+    if (!cache) return NULL;
+
+    cache->quantized_type  = quantized_type;
+    cache->num_features    = num_features;
+    cache->group_size      = group_size;
+    cache->tokens_per_page = tokens_per_page;
+    return cache;
+}
+
+void free_quantized_cache(quantized_cache_t *cache) {
+    if (!cache) return;
+    for (uint64_t p = 0; p < cache->num_pages; ++p) free_token_quantized_array(cache->pages[p]);
+    free(cache->pages);
+    free(cache);
+}
+
+uint64_t get_quantized_cache_size(const quantized_cache_t *cache) {
+    if (!cache) return 0;
+
+    uint64_t total = sizeof(quantized_cache_t) + cache->page_capacity * sizeof(token_quantized_array_t*);
+    for (uint64_t p = 0; p < cache->num_pages; ++p) total += get_token_quantized_array_size(cache->pages[p]);
+    return total;
+}
+
+/* Makes sure pages exist for the first num_tokens tokens. */
+static int _reserve_pages(quantized_cache_t *cache, uint64_t num_tokens) {
+    const uint64_t needed = (num_tokens + cache->tokens_per_page - 1) / cache->tokens_per_page;
+
+    if (needed > cache->page_capacity) {
+        uint64_t capacity = cache->page_capacity ? cache->page_capacity : 4;
+        while (capacity < needed) capacity *= 2;
+
+        token_quantized_array_t **pages = realloc(cache->pages, capacity * sizeof(*pages));
+        if (!pages) return 1;
+        cache->pages = pages;
+        cache->page_capacity = capacity;
+    }
+
+    while (cache->num_pages < needed) {
+        token_quantized_array_t *page = allocate_token_quantized_array(cache->tokens_per_page, cache->num_features,
+                                                                       cache->quantized_type, cache->group_size);
+        if (!page) return 1;
+        cache->pages[cache->num_pages++] = page;
+    }
+    return 0;
+}
+
+int append_to_quantized_cache(quantized_cache_t *cache,
+                              const float *float_array,
+                              uint64_t num_tokens) {
+    if (!cache || !float_array || !num_tokens) return 1;
+    if (_reserve_pages(cache, cache->num_tokens + num_tokens)) return 1;
+
+    const uint64_t first_token = cache->num_tokens;
+    int failed = 0;
+
+#pragma omp parallel for if(num_tokens > 1) schedule(static) reduction(|:failed)
+    for (uint64_t i = 0; i < num_tokens; ++i) {
+        const uint64_t token = first_token + i;
+        token_quantized_array_t *page = cache->pages[token / cache->tokens_per_page];
+        failed |= quantize_token_row(float_array + i * cache->num_features, page,
+                                     (uint16_t)(token % cache->tokens_per_page));
+    }
+    if (failed) return 1;
+
+    cache->num_tokens += num_tokens;
+    return 0;
+}
+
+int read_from_quantized_cache(const quantized_cache_t *cache,
+                              uint64_t first_token,
+                              uint64_t num_tokens,
+                              float *float_array) {
+    if (!cache || !float_array || !num_tokens) return 1;
+    if (first_token > cache->num_tokens || num_tokens > cache->num_tokens - first_token) return 1;
+
+    int failed = 0;
+
+#pragma omp parallel for if(num_tokens > 1) schedule(static) reduction(|:failed)
+    for (uint64_t i = 0; i < num_tokens; ++i) {
+        const uint64_t token = first_token + i;
+        const token_quantized_array_t *page = cache->pages[token / cache->tokens_per_page];
+        failed |= dequantize_token_row(page, (uint16_t)(token % cache->tokens_per_page),
+                                       float_array + i * cache->num_features);
+    }
+    return failed;
+}
+
+int truncate_quantized_cache(quantized_cache_t *cache, uint64_t num_tokens) {
+    if (!cache || num_tokens > cache->num_tokens) return 1;
+    cache->num_tokens = num_tokens;
+    return 0;
+}
@@ -0,0 +1,16 @@
+#include "metrics.h"
+
+void codec_metrics_finalize(double sum_abs_error,
+                            double sum_sq_error,
+                            double max_abs_error,
+                            double sum_sq_signal,
+                            uint64_t num_elements,
+                            codec_metrics_t *metrics) {
+    if (!metrics) return;
+
+    const double n = num_elements ? (double)num_elements : 1.0;
+    metrics->mae     = sum_abs_error / n;
+    metrics->mse     = sum_sq_error / n;
+    metrics->max_abs = max_abs_error;
+    metrics->sqnr_db = (sum_sq_error > 0.0) ? 10.0 * log10(sum_sq_signal / sum_sq_error) : INFINITY;
+}
@@ -0,0 +1,174 @@
+#define _GNU_SOURCE                     /* cpu_set_t, sched_setaffinity */
+
+#include "numa_placement.h"
+
+#include <ctype.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+#define _UNBOUND (-1)
+
+static numa_topology_t _topology;
+static atomic_int _topology_ready;
+static atomic_uint _options;
+static cpu_set_t _default_mask;         /* affinity to restore when the options are cleared */
+
+/* what the calling worker is bound to: a CPU id, NUMA_MAX_CPUS + node for a node pool, or _UNBOUND */
+static _Thread_local int _bound_key = _UNBOUND;
+
+/* the affinity a team's thread 0, i.e. the codec's caller, had before the region bound it */
+static _Thread_local cpu_set_t _caller_mask;
+static _Thread_local int _caller_key;
+static _Thread_local int _caller_saved;
+
+/* ---- Topology -------------------------------------------------------------- */
+
+int numa_parse_cpulist(const char *cpulist, uint16_t *cpus, uint32_t max_cpus, uint32_t *num_cpus) {
+    if (!cpulist || !cpus || !num_cpus) return 1;
+
+    uint32_t count = 0;
+    const char *p = cpulist;
+    while (*p && *p != '\n') {
+        if (!isdigit((unsigned char)*p)) return 1;
+        char *end;
+        const unsigned long first = strtoul(p, &end, 10);
+        unsigned long last = first;
+        if (*end == '-') {
+            if (!isdigit((unsigned char)end[1])) return 1;
+            last = strtoul(end + 1, &end, 10);
+        }
+        if (last < first) return 1;
+        for (unsigned long cpu = first; cpu <= last && cpu < NUMA_MAX_CPUS; ++cpu) {
+            if (count == max_cpus) return 1;
+            cpus[count++] = (uint16_t)cpu;
+        }
+        if (*end == ',') end++;
+        else if (*end && *end != '\n') return 1;
+        p = end;
+    }
+    *num_cpus = count;
+    return 0;
+}
+
+/* One node per sysfs node directory with CPUs; falls back to the CPUs the process may use. */
+static void _detect_topology(numa_topology_t *topology) {
+    memset(topology, 0, sizeof(*topology));
+
+    char path[64], line[4096];
+    for (uint32_t node = 0; node < NUMA_MAX_NODES; ++node) {
+        snprintf(path, sizeof(path), NUMA_SYSFS_NODE, node);
+        FILE *file = fopen(path, "r");
+        if (!file) continue;                /* node ids may have holes */
+        const int read_ok = fgets(line, sizeof(line), file) != NULL;
+        fclose(file);
+
+        const uint32_t n = topology->num_nodes;
+        uint32_t num_cpus = 0;
+        if (!read_ok || numa_parse_cpulist(line, topology->cpus + topology->num_cpus,
+                                           NUMA_MAX_CPUS - topology->num_cpus, &num_cpus) || !num_cpus)
+            continue;                       /* memory-only node or unreadable list */
+        topology->node_ids[n]         = node;
+        topology->node_offsets[n]     = topology->num_cpus;
+        topology->num_cpus           += num_cpus;
+        topology->node_offsets[n + 1] = topology->num_cpus;
+        topology->num_nodes++;
+    }
+    if (topology->num_nodes) return;
+
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) != 0) CPU_SET(0, &mask);
+    for (uint32_t cpu = 0; cpu < NUMA_MAX_CPUS && cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &mask)) topology->cpus[topology->num_cpus++] = (uint16_t)cpu;
+    }
+    topology->num_nodes       = 1;
+    topology->node_offsets[1] = topology->num_cpus;
+}
+
+static const numa_topology_t *_get_topology(void) {
+    if (!atomic_load(&_topology_ready)) {
+#pragma omp critical(numa_topology)
+        {
+            if (!atomic_load(&_topology_ready)) {
+                _detect_topology(&_topology);
+                atomic_store(&_topology_ready, 1);
+            }
+        }
+    }
+    return &_topology;
+}
+
+void numa_get_topology(numa_topology_t *topology) {
+    if (!topology) return;
+    *topology = *_get_topology();
+}
+
+/* ---- Options ---------------------------------------------------------------- */
+
+int numa_set_options(uint32_t options) {
+    const int pinning = (options & (NUMA_PIN_THREADS | NUMA_NODE_POOLS)) != 0;
+    if (pinning && !(atomic_load(&_options) & (NUMA_PIN_THREADS | NUMA_NODE_POOLS))) {
+        /* remember the unpinned mask before any worker is bound */
+        if (sched_getaffinity(0, sizeof(_default_mask), &_default_mask) != 0) return 1;
+    }
+    _get_topology();
+    atomic_store(&_options, options);
+    return 0;
+}
+
+uint32_t numa_get_options(void) {
+    return atomic_load(&_options);
+}
+
+uint32_t numa_node_of_worker(uint32_t thread_num, uint32_t num_threads) {
+    const numa_topology_t *topology = _get_topology();
+    if (num_threads == 0 || thread_num >= num_threads) return 0;
+    return (uint32_t)((uint64_t)thread_num * topology->num_nodes / num_threads);
+}
+
+void numa_bind_worker(uint32_t thread_num, uint32_t num_threads) {
+    const uint32_t options = atomic_load_explicit(&_options, memory_order_relaxed);
+    if (!(options & (NUMA_PIN_THREADS | NUMA_NODE_POOLS))) {
+        if (_bound_key != _UNBOUND && sched_setaffinity(0, sizeof(_default_mask), &_default_mask) == 0)
+            _bound_key = _UNBOUND;
+        return;
+    }
+
+    const numa_topology_t *topology = _get_topology();
+    const uint32_t node = numa_node_of_worker(thread_num, num_threads);
+    const uint32_t first_cpu = topology->node_offsets[node];
+    const uint32_t node_cpus = topology->node_offsets[node + 1] - first_cpu;
+
+    int key;
+    if (options & NUMA_PIN_THREADS) {
+        /* rank inside the node's group of workers, spread round-robin over its CPUs */
+        const uint32_t first_worker = (uint32_t)(((uint64_t)node * num_threads + topology->num_nodes - 1) / topology->num_nodes);
+        key = topology->cpus[first_cpu + (thread_num - first_worker) % node_cpus];
+    } else {
+        key = NUMA_MAX_CPUS + (int)node;
+    }
+    if (key == _bound_key) return;
+
+    if (thread_num == 0 && !_caller_saved) {
+        /* never bind the caller for good: numa_release_worker hands its own affinity back */
+        if (sched_getaffinity(0, sizeof(_caller_mask), &_caller_mask) != 0) return;
+        _caller_key   = _bound_key;
+        _caller_saved = 1;
+    }
+
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (key < NUMA_MAX_CPUS) {
+        CPU_SET(key, &mask);
+    } else {
+        for (uint32_t c = 0; c < node_cpus; ++c) CPU_SET(topology->cpus[first_cpu + c], &mask);
+    }
+    if (sched_setaffinity(0, sizeof(mask), &mask) == 0) _bound_key = key;
+}
+
+void numa_release_worker(uint32_t thread_num) {
+    if (thread_num != 0 || !_caller_saved) return;
+    if (sched_setaffinity(0, sizeof(_caller_mask), &_caller_mask) == 0) _bound_key = _caller_key;
+    _caller_saved = 0;
+}
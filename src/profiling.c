@@ -0,0 +1,120 @@
+#include <stdatomic.h>
+#include <omp.h>
+
+#include "profiling.h"
+
+typedef struct {
+    atomic_uint_least64_t calls;
+    atomic_uint_least64_t elements;
+    atomic_uint_least64_t bytes_in;
+    atomic_uint_least64_t bytes_out;
+    atomic_uint_least64_t ns;
+} _atomic_counters_t;
+
+/* one cache-line aligned slot per thread, so the owner's relaxed adds never contend */
+typedef struct {
+    _Alignas(64) _atomic_counters_t counters[CODEC_OP_COUNT][CODEC_PROFILE_MAX_FORMATS];
+} _profile_slot_t;
+
+static _profile_slot_t _slots[CODEC_PROFILE_MAX_THREADS];
+static atomic_uint _next_slot;
+static _Thread_local int _thread_slot = -1;
+
+static _Atomic(codec_trace_hook_t) _begin_hook;
+static _Atomic(codec_trace_hook_t) _end_hook;
+static _Atomic(void *) _hook_user_data;
+
+static inline uint64_t _now_ns(void) {
+    return (uint64_t)(omp_get_wtime() * 1e9);
+}
+
+static inline _profile_slot_t *_get_thread_slot(void) {
+    if (_thread_slot < 0) {
+        unsigned int slot = atomic_fetch_add_explicit(&_next_slot, 1, memory_order_relaxed);
+        _thread_slot = (int)(slot % CODEC_PROFILE_MAX_THREADS);
+    }
+    return &_slots[_thread_slot];
+}
+
+static inline void _add(atomic_uint_least64_t *counter, uint64_t value) {
+    atomic_fetch_add_explicit(counter, value, memory_order_relaxed);
+}
+
+uint64_t codec_profile_begin(codec_op_t op, uint8_t format, uint64_t num_elements) {
+#ifdef ENABLE_TRACING
+    codec_trace_hook_t hook = atomic_load_explicit(&_begin_hook, memory_order_acquire);
+    if (hook) hook(op, format, num_elements, atomic_load_explicit(&_hook_user_data, memory_order_relaxed));
+#else
+    (void)op; (void)format; (void)num_elements;
+#endif
+
+#ifdef ENABLE_PROFILING
+    return _now_ns();
+#else
+    return 0;
+#endif
+}
+
+void codec_profile_end(codec_op_t op, uint8_t format, uint64_t num_elements,
+                       uint64_t bytes_in, uint64_t bytes_out, uint64_t start_ns) {
+#ifdef ENABLE_PROFILING
+    if (op < CODEC_OP_COUNT && format < CODEC_PROFILE_MAX_FORMATS) {
+        const uint64_t elapsed = _now_ns() - start_ns;
+        _atomic_counters_t *c = &_get_thread_slot()->counters[op][format];
+        _add(&c->calls, 1);
+        _add(&c->elements, num_elements);
+        _add(&c->bytes_in, bytes_in);
+        _add(&c->bytes_out, bytes_out);
+        _add(&c->ns, elapsed);
+    }
+#else
+    (void)bytes_in; (void)bytes_out; (void)start_ns;
+#endif
+
+#ifdef ENABLE_TRACING
+    codec_trace_hook_t hook = atomic_load_explicit(&_end_hook, memory_order_acquire);
+    if (hook) hook(op, format, num_elements, atomic_load_explicit(&_hook_user_data, memory_order_relaxed));
+#elif !defined(ENABLE_PROFILING)
+    (void)op; (void)format; (void)num_elements;
+#endif
+}
+
+void codec_profile_snapshot(codec_profile_t *snapshot) {
+    if (!snapshot) return;
+    memset(snapshot, 0, sizeof(*snapshot));
+
+    for (int s = 0; s < CODEC_PROFILE_MAX_THREADS; ++s) {
+        for (int op = 0; op < CODEC_OP_COUNT; ++op) {
+            for (int f = 0; f < CODEC_PROFILE_MAX_FORMATS; ++f) {
+                const _atomic_counters_t *src = &_slots[s].counters[op][f];
+                codec_counters_t *dst = &snapshot->counters[op][f];
+                dst->calls     += atomic_load_explicit(&src->calls, memory_order_relaxed);
+                dst->elements  += atomic_load_explicit(&src->elements, memory_order_relaxed);
+                dst->bytes_in  += atomic_load_explicit(&src->bytes_in, memory_order_relaxed);
+                dst->bytes_out += atomic_load_explicit(&src->bytes_out, memory_order_relaxed);
+                dst->ns        += atomic_load_explicit(&src->ns, memory_order_relaxed);
+            }
+        }
+    }
+}
+
+void codec_profile_reset(void) {
+    for (int s = 0; s < CODEC_PROFILE_MAX_THREADS; ++s) {
+        for (int op = 0; op < CODEC_OP_COUNT; ++op) {
+            for (int f = 0; f < CODEC_PROFILE_MAX_FORMATS; ++f) {
+                _atomic_counters_t *c = &_slots[s].counters[op][f];
+                atomic_store_explicit(&c->calls, 0, memory_order_relaxed);
+                atomic_store_explicit(&c->elements, 0, memory_order_relaxed);
+                atomic_store_explicit(&c->bytes_in, 0, memory_order_relaxed);
+                atomic_store_explicit(&c->bytes_out, 0, memory_order_relaxed);
+                atomic_store_explicit(&c->ns, 0, memory_order_relaxed);
+            }
+        }
+    }
+}
+
+void codec_set_trace_hooks(codec_trace_hook_t begin, codec_trace_hook_t end, void *user_data) {
+    atomic_store_explicit(&_hook_user_data, user_data, memory_order_relaxed);
+    atomic_store_explicit(&_begin_hook, begin, memory_order_release);
+    atomic_store_explicit(&_end_hook, end, memory_order_release);
+}
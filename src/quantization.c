@@ -1,82 +1,184 @@
 #include "quantization.h"
+#include "profiling.h"
+#include "rotation.h"
+#include "block_kernels.h"
+#include "autotune.h"
+#include "numa_placement.h"
 
-static int64_t _get_q8_0_quantized_array_size(const quantized_array_t *quantized_array) {
-    if (!quantized_array) return 0;
-    return sizeof(quantized_array_t)    /* quantized_type num_elements, num_blocks, block_size */
-         + quantized_array->num_blocks * sizeof(float)   /* scales */
-         + quantized_array->num_elements * sizeof(int8_t); /* data */
+#include <omp.h>
+
+/* Floats stored per block: the scale, plus the min (q4_1, q5_1) or the scaled block sum (q8_1). */
+static uint64_t _get_scales_per_block(uint8_t quantized_type) {
+    switch (quantized_type) {
+        case 2: /* q4_1 */
+        case 4: /* q5_1 */
+        case 5: /* q8_1 */
+            return 2;
+        default:
+            return 1;
+    }
 }
 
-static int64_t _get_q4_0_quantized_array_size(const quantized_array_t *quantized_array) {
-    if (!quantized_array) return 0;
+/* Bytes of quantized values: int8 for the 8-bit formats, packed nibbles (+ a high-bit plane for 5-bit). */
+static uint64_t _get_data_size(uint8_t quantized_type, uint64_t num_elements) {
+    switch (quantized_type) {
+        case 0: /* q8_0 */
+        case 5: /* q8_1 */
+            return num_elements * sizeof(int8_t);
+        case 1: /* q4_0 */
+        case 2: /* q4_1 */
+            return (num_elements + 1) / 2;
+        case 3: /* q5_0 */
+        case 4: /* q5_1 */
+            return (num_elements + 1) / 2 + (num_elements + 7) / 8;
+        default:
+            return 0; /* unknown type */
+    }
+}
 
-    const uint64_t num_elements_for_data = (quantized_array->num_elements + 1) / 2;
+int64_t get_quantized_array_size(const quantized_array_t *quantized_array) {
+    if (!quantized_array) return 0;
+    if (quantized_array->quantized_type >= QUANTIZED_TYPE_COUNT) return 0; /* unknown type */
 
     return sizeof(quantized_array_t)    /* quantized_type num_elements, num_blocks, block_size */
-        + quantized_array->num_blocks * sizeof(float)   /* scales */
-        + num_elements_for_data * sizeof(int8_t);   /* packed data */
+         + quantized_array->num_blocks * _get_scales_per_block(quantized_array->quantized_type) * sizeof(float)  /* scales */
+         + _get_data_size(quantized_array->quantized_type, quantized_array->num_elements);  /* data */
 }
 
-int64_t get_quantized_array_size(const quantized_array_t *quantized_array) {
-    if (!quantized_array) return 0;
-    switch (quantized_array->quantized_type) {
-        case 0: 
-            return _get_q8_0_quantized_array_size(quantized_array);
-        case 1:
-            return _get_q4_0_quantized_array_size(quantized_array);
-        default: 
-            return 0; /* unknown type */
+#define KERNEL_CHUNK_BLOCKS 64      /* blocks handed to a thread per scheduling step */
+
+/* Threads and blocks per scheduling step of a quantize kernel run; first touch must use the same. */
+static void _get_quantize_config(uint8_t quantized_type, uint64_t num_elements, autotune_config_t *config) {
+    config->num_threads = (uint32_t)omp_get_max_threads();
+    config->chunk       = KERNEL_CHUNK_BLOCKS;
+    config->kernel      = 0;
+    autotune_apply(AUTOTUNE_OP_QUANTIZE, quantized_type, num_elements, 0, 0, config);
+}
+
+/* Zeroes the scales and data bytes of blocks [first_block, end_block); the last range also takes the tail. */
+static void _zero_block_range(quantized_array_t *qa, uint64_t first_block, uint64_t end_block) {
+    const uint64_t scales_per_block = _get_scales_per_block(qa->quantized_type);
+    const uint64_t first = first_block * qa->block_size;
+    const uint64_t end   = (end_block == qa->num_blocks) ? qa->num_elements : end_block * qa->block_size;
+    const int is_last    = end_block == qa->num_blocks;
+    uint8_t *data = (uint8_t *)qa->data;
+
+    memset(qa->scales + first_block * scales_per_block, 0, (end_block - first_block) * scales_per_block * sizeof(float));
+    switch (qa->quantized_type) {
+        case 0: /* q8_0 */
+        case 5: /* q8_1 */
+            memset(data + first, 0, end - first);
+            break;
+        case 3: /* q5_0 */
+        case 4: { /* q5_1: the high-bit plane follows the nibbles */
+            const uint64_t plane = (qa->num_elements + 1) / 2;
+            const uint64_t high_end = is_last ? (qa->num_elements + 7) / 8 : end / 8;
+            memset(data + plane + first / 8, 0, high_end - first / 8);
+        }
+        /* fall through */
+        default: { /* q4_0 / q4_1 nibbles */
+            const uint64_t nibble_end = is_last ? (qa->num_elements + 1) / 2 : end / 2;
+            memset(data + first / 2, 0, nibble_end - first / 2);
+            break;
+        }
     }
 }
 
-quantized_array_t *allocate_q8_0_array(uint64_t num_elements,
-                                       uint64_t block_size) {
-    if (!num_elements || !block_size) return NULL;
+/*
+ * First-touch initialization: every chunk of blocks is zeroed by the thread that the quantize
+ * kernel's static schedule will hand it to, so its pages land on that thread's NUMA node.
+ */
+static void _first_touch_quantized_array(quantized_array_t *qa) {
+    autotune_config_t config;
+    _get_quantize_config(qa->quantized_type, qa->num_elements, &config);
+    const uint64_t num_full_blocks = qa->num_elements / qa->block_size;
+    const uint64_t chunk_blocks = config.chunk;
+    const uint64_t num_chunks = (num_full_blocks + chunk_blocks - 1) / chunk_blocks;
+
+    if (num_chunks == 0) {
+        _zero_block_range(qa, 0, qa->num_blocks);
+        return;
+    }
+
+#pragma omp parallel num_threads(config.num_threads) if(config.num_threads > 1 && num_chunks > 1)
+    {
+        numa_bind_worker((uint32_t)omp_get_thread_num(), (uint32_t)omp_get_num_threads());
+
+#pragma omp for schedule(static)
+        for (uint64_t chunk = 0; chunk < num_chunks; ++chunk) {
+            const uint64_t first_block = chunk * chunk_blocks;
+            const uint64_t end_block = (chunk + 1 == num_chunks) ? qa->num_blocks : first_block + chunk_blocks;
+            _zero_block_range(qa, first_block, end_block);
+        }
+        numa_release_worker((uint32_t)omp_get_thread_num());
+    }
+}
 
+static quantized_array_t *_allocate_quantized_array(uint8_t quantized_type,
+                                                    uint64_t num_elements,
+                                                    uint64_t block_size) {
     uint64_t num_blocks = (num_elements + block_size - 1) / block_size;
+    uint64_t num_scales = num_blocks * _get_scales_per_block(quantized_type);
 
     size_t total = sizeof(quantized_array_t)
-                 + num_blocks * sizeof(float)
-                 + num_elements * sizeof(int8_t);
+                 + num_scales * sizeof(float)
+                 + _get_data_size(quantized_type, num_elements);
 
-    quantized_array_t *qa = (quantized_array_t*)calloc(1, total);
+    /* with first touch the pages stay unfaulted here and are zeroed by the workers that will write them */
+    const int first_touch = (numa_get_options() & NUMA_FIRST_TOUCH) != 0;
+    quantized_array_t *qa = (quantized_array_t*)(first_touch ? malloc(total) : calloc(1, total));
     if (!qa) return NULL;
 
     /* initialise the header fields */
-    qa->quantized_type = 0;          /* q8_0 */
+    memset(qa, 0, sizeof(quantized_array_t));
+    qa->quantized_type = quantized_type;
     qa->num_elements   = num_elements;
     qa->num_blocks     = num_blocks;
     qa->block_size     = block_size;
 
     qa->scales = (float*)(qa + 1);                /* just after the header */
-    qa->data   = (int8_t*)(qa->scales + num_blocks);  /* after the scales */
+    qa->data   = (int8_t*)(qa->scales + num_scales);  /* after the scales */
 
+    if (first_touch) _first_touch_quantized_array(qa);
     return qa;
 }
 
-quantized_array_t *allocate_q4_0_array(uint64_t num_elements,
+quantized_array_t *allocate_q8_0_array(uint64_t num_elements,
                                        uint64_t block_size) {
     if (!num_elements || !block_size) return NULL;
+    return _allocate_quantized_array(0, num_elements, block_size);
+}
 
-    uint64_t num_blocks = (num_elements + block_size - 1) / block_size;
-    uint64_t num_elements_for_data = (num_elements + 1) / 2;
+quantized_array_t *allocate_q4_0_array(uint64_t num_elements,
+                                       uint64_t block_size) {
+    /* two elements share a byte, an odd block size would split a byte across blocks */
+    if (!num_elements || !block_size || block_size % 2) return NULL;
+    return _allocate_quantized_array(1, num_elements, block_size);
+}
 
-    size_t total = sizeof(quantized_array_t)
-                 + num_blocks * sizeof(float)
-                 + num_elements_for_data * sizeof(int8_t);
-    
-    quantized_array_t *qa = (quantized_array_t*)calloc(1, total);
-    if (!qa) return NULL;
+quantized_array_t *allocate_q4_1_array(uint64_t num_elements,
+                                       uint64_t block_size) {
+    if (!num_elements || !block_size || block_size % 2) return NULL;
+    return _allocate_quantized_array(2, num_elements, block_size);
+}
 
-    qa->quantized_type = 1;          /* q4_0 */
-    qa->num_elements   = num_elements;
-    qa->num_blocks     = num_blocks;
-    qa->block_size     = block_size;
+quantized_array_t *allocate_q5_0_array(uint64_t num_elements,
+                                       uint64_t block_size) {
+    /* eight elements share a byte of the high-bit plane */
+    if (!num_elements || !block_size || block_size % 8) return NULL;
+    return _allocate_quantized_array(3, num_elements, block_size);
+}
 
-    qa->scales = (float*)(qa + 1);
-    qa->data   = (int8_t*)(qa->scales + num_blocks);
+quantized_array_t *allocate_q5_1_array(uint64_t num_elements,
+                                       uint64_t block_size) {
+    if (!num_elements || !block_size || block_size % 8) return NULL;
+    return _allocate_quantized_array(4, num_elements, block_size);
+}
 
-    return qa;
+quantized_array_t *allocate_q8_1_array(uint64_t num_elements,
+                                       uint64_t block_size) {
+    if (!num_elements || !block_size) return NULL;
+    return _allocate_quantized_array(5, num_elements, block_size);
 }
 
 void free_quantized_array(quantized_array_t *quantized_array) {
@@ -89,193 +191,954 @@ quantized_array_t *load_quantized_array_from_buffer(const void *buffer, int64_t
     if (!quantized_array) return NULL;
     
     memcpy(quantized_array, buffer, buffer_size);
-    switch (quantized_array->quantized_type) {
-        case 0: /* q8_0 */
-            quantized_array->scales = (float*)(quantized_array + 1);
-            quantized_array->data   = (int8_t*)(quantized_array->scales + quantized_array->num_blocks);
-            return quantized_array;
-        case 1: /* q4_0 */
-            quantized_array->scales = (float*)(quantized_array + 1);
-            quantized_array->data   = (int8_t*)(quantized_array->scales + quantized_array->num_blocks);
-            return quantized_array;
-        default: 
-            return NULL; /* unknown type */
+    if (quantized_array->quantized_type >= QUANTIZED_TYPE_COUNT) {
+        free(quantized_array);
+        return NULL; /* unknown type */
     }
+    const uint64_t rotation_size = quantized_array->rotation_size;
+    if (rotation_size && ((rotation_size & (rotation_size - 1)) || quantized_array->num_elements % rotation_size)) {
+        free(quantized_array);
+        return NULL; /* rotation blocks must tile the array */
+    }
+
+    const uint64_t num_scales = quantized_array->num_blocks * _get_scales_per_block(quantized_array->quantized_type);
+    quantized_array->scales = (float*)(quantized_array + 1);
+    quantized_array->data   = (int8_t*)(quantized_array->scales + num_scales);
+    return quantized_array;
 }
 
-static int _quantize_q8_0(const float *float_array,
-                          quantized_array_t *quantized_array) {
-    if (!float_array || !quantized_array) return 1;
+int view_quantized_array_from_buffer(const void *buffer, uint64_t buffer_size, quantized_array_t *view) {
+    if (!buffer || !view || buffer_size < sizeof(quantized_array_t)) return 1;
 
-    const uint64_t block_size   = quantized_array->block_size;
-    const uint64_t num_blocks   = quantized_array->num_blocks;
-    const uint64_t num_elements = quantized_array->num_elements;
+    quantized_array_t header;
+    memcpy(&header, buffer, sizeof(quantized_array_t));
+    if (header.quantized_type >= QUANTIZED_TYPE_COUNT) return 1; /* unknown type */
+    if (!header.num_elements || !header.block_size) return 1;
+    if (header.num_blocks != (header.num_elements + header.block_size - 1) / header.block_size) return 1;
+    if (header.rotation_size && ((header.rotation_size & (header.rotation_size - 1)) ||
+                                 header.num_elements % header.rotation_size)) return 1;
+    if ((uint64_t)get_quantized_array_size(&header) > buffer_size) return 1;
+
+    const uint64_t num_scales = header.num_blocks * _get_scales_per_block(header.quantized_type);
+    header.scales = (float*)((uint8_t*)buffer + sizeof(quantized_array_t));
+    header.data   = (int8_t*)(header.scales + num_scales);
+    *view = header;
+    return 0;
+}
+
+/* ---- Block kernels ------------------------------------------------------- */
+
+#define ROTATION_TILE_ELEMENTS 2048 /* elements rotated per scheduling step, rounded up to whole Hadamard and quantization blocks */
 
-    for (uint64_t b = 0; b < num_blocks; ++b) {
-        const uint64_t start = b * block_size;
-        const uint64_t remain = (start + block_size <= num_elements)
-                                  ? block_size
-                                  : (num_elements - start);
-
-        /* 1) find max‑abs in this block */
-        float abs_max = 0.0f;
-        for (uint64_t i = 0; i < remain; ++i) {
-            float v = fabsf(float_array[start + i]);
-            if (v > abs_max) abs_max = v;
+/* ---- Asymmetric and 5-bit blocks ----------------------------------------- */
+
+#define ERROR_SUB_BLOCK 64      /* elements decoded at a time when measuring a block's error */
+
+static inline void _block_min_max(const float *x, uint64_t n, float *vmin, float *vmax) {
+    float lo = x[0], hi = x[0];
+#pragma omp simd reduction(min:lo) reduction(max:hi)
+    for (uint64_t i = 0; i < n; ++i) {
+        lo = (x[i] < lo) ? x[i] : lo;
+        hi = (x[i] > hi) ? x[i] : hi;
+    }
+    *vmin = lo;
+    *vmax = hi;
+}
+
+/* The element of largest magnitude, with its sign (the positive one on ties). */
+static inline float _block_signed_abs_max(const float *x, uint64_t n) {
+    float vmin, vmax;
+    _block_min_max(x, n, &vmin, &vmax);
+    return (-vmin > vmax) ? vmin : vmax;
+}
+
+static inline float _q4_1_value(float d, float m, uint8_t q) {
+    return d * (float)q + m;
+}
+
+/* 5-bit codes decode as d * (q - bias) + offset: bias 16 / offset 0 for q5_0, bias 0 / offset m for q5_1 */
+static inline float _q5_value(float d, float offset, float bias, uint8_t q) {
+    return d * ((float)q - bias) + offset;
+}
+
+/* Unsigned nibbles q = round((x - m) / d) in [0, 15]; dm receives {d, m}. */
+static inline void _quantize_q4_1_block(const float *restrict x, uint8_t *restrict q,
+                                        float *restrict dm, uint64_t n) {
+    float vmin, vmax;
+    _block_min_max(x, n, &vmin, &vmax);
+
+    const float scale = (vmax - vmin) / 15.0f;
+    const float inv_scale = (scale > 0.0f) ? (1.0f / scale) : 0.0f;
+
+    const uint64_t num_pairs = n / 2;
+#pragma omp simd
+    for (uint64_t p = 0; p < num_pairs; ++p) {
+        const int hi = (int)_clamp(_round_nearest((x[2 * p] - vmin) * inv_scale), 0.0f, 15.0f);
+        const int lo = (int)_clamp(_round_nearest((x[2 * p + 1] - vmin) * inv_scale), 0.0f, 15.0f);
+        q[p] = (uint8_t)((hi << 4) | lo);
+    }
+    if (n % 2) {
+        const int hi = (int)_clamp(_round_nearest((x[n - 1] - vmin) * inv_scale), 0.0f, 15.0f);
+        q[num_pairs] = (uint8_t)(hi << 4);
+    }
+    dm[0] = scale;
+    dm[1] = vmin;
+}
+
+static inline void _dequantize_q4_1_block(const uint8_t *restrict q, float d, float m,
+                                          float *restrict y, uint64_t n) {
+    const uint64_t num_pairs = n / 2;
+#pragma omp simd
+    for (uint64_t p = 0; p < num_pairs; ++p) {
+        y[2 * p]     = _q4_1_value(d, m, q[p] >> 4);
+        y[2 * p + 1] = _q4_1_value(d, m, q[p] & 0x0F);
+    }
+    if (n % 2) {
+        y[n - 1] = _q4_1_value(d, m, q[num_pairs] >> 4);
+    }
+}
+
+#define Q5_SUB_BLOCK 64         /* elements encoded at a time; a multiple of 8 */
+
+static inline uint8_t _q5_code(float x, float offset, float inv_scale, float bias) {
+    return (uint8_t)_clamp(_round_nearest((x - offset) * inv_scale) + bias, 0.0f, 31.0f);
+}
+
+/*
+ * 5-bit codes q = round((x - offset) * inv_scale) + bias in [0, 31]. A pair loop shaped like
+ * q4_1 packs the low nibbles and keeps each fifth bit; a second loop folds those into the
+ * high-bit plane qh, one byte per 8-element group.
+ */
+static inline void _quantize_q5_block(const float *restrict x, uint8_t *restrict q, uint8_t *restrict qh,
+                                      uint64_t n, float offset, float inv_scale, float bias) {
+    for (uint64_t j = 0; j < n; j += Q5_SUB_BLOCK) {
+        const uint64_t m = (n - j < Q5_SUB_BLOCK) ? n - j : Q5_SUB_BLOCK;
+        const float *restrict xs = x + j;
+        uint8_t *restrict qs = q + j / 2;
+        uint8_t high[Q5_SUB_BLOCK] = {0};
+
+        const uint64_t num_pairs = m / 2;
+#pragma omp simd
+        for (uint64_t p = 0; p < num_pairs; ++p) {
+            const uint8_t hi = _q5_code(xs[2 * p], offset, inv_scale, bias);
+            const uint8_t lo = _q5_code(xs[2 * p + 1], offset, inv_scale, bias);
+            qs[p] = (uint8_t)(((hi & 0x0F) << 4) | (lo & 0x0F));
+            high[2 * p]     = hi >> 4;
+            high[2 * p + 1] = lo >> 4;
+        }
+        if (m % 2) {
+            const uint8_t hi = _q5_code(xs[m - 1], offset, inv_scale, bias);
+            qs[num_pairs] = (uint8_t)((hi & 0x0F) << 4);
+            high[m - 1]   = hi >> 4;
         }
 
-        /* 2) compute scale */
-        float scale = (abs_max > 0.0f) ? (abs_max / 127.0f) : 0.0f;
-        float inv_scale = (scale > 0.0f) ? (1.0f / scale) : 0.0f;
-        quantized_array->scales[b] = scale;
-
-        /* 3) quantise */
-        for (uint64_t i = 0; i < remain; ++i) {
-            float val = float_array[start + i] * inv_scale;
-            long qi   = lrintf(val); /* nearest int */
-            if (qi < -127) qi = -127;
-            if (qi >  127) qi =  127;
-            quantized_array->data[start + i] = (int8_t)qi;
+        const uint64_t num_groups = (m + 7) / 8;
+#pragma omp simd
+        for (uint64_t g = 0; g < num_groups; ++g) {
+            const uint8_t *h = high + 8 * g;
+            qh[j / 8 + g] = (uint8_t)(h[0] | (h[1] << 1) | (h[2] << 2) | (h[3] << 3) |
+                                      (h[4] << 4) | (h[5] << 5) | (h[6] << 6) | (h[7] << 7));
         }
     }
-    return 0;
 }
 
-static int _quantize_q4_0(const float *float_array,
-                          quantized_array_t *quantized_array) {
-    if (!float_array || !quantized_array) return 1;
+static inline void _dequantize_q5_block(const uint8_t *restrict q, const uint8_t *restrict qh,
+                                        float d, float offset, float bias,
+                                        float *restrict y, uint64_t n) {
+#pragma omp simd
+    for (uint64_t i = 0; i < n; ++i) {
+        const uint8_t nibble = (i % 2 == 0) ? (q[i / 2] >> 4) : (q[i / 2] & 0x0F);
+        const uint8_t high = (qh[i / 8] >> (i % 8)) & 1;
+        y[i] = _q5_value(d, offset, bias, (uint8_t)(nibble | (high << 4)));
+    }
+}
 
-    const uint64_t block_size   = quantized_array->block_size;
-    const uint64_t num_blocks   = quantized_array->num_blocks;
-    const uint64_t num_elements = quantized_array->num_elements;
-    uint8_t *data = (uint8_t *)quantized_array->data;
-    
-    for (uint64_t b = 0; b < num_blocks; ++b) {
-        const uint64_t start = b * block_size;
-        const uint64_t remain = (start + block_size <= num_elements)
-                                  ? block_size
-                                  : (num_elements - start);
-
-        /* 1) find max‑abs in this block */
-        float abs_max = 0.0f;
-        for (uint64_t i = 0; i < remain; ++i) {
-            float v = fabsf(float_array[start + i]);
-            if (v > abs_max) abs_max = v;
+/* ---- Array-level block entry points --------------------------------------- */
+
+/*
+ * One quantize / dequantize pair per format with a common signature: block b of the array,
+ * whose first encoded element is start, covering n elements (n < block_size only for the tail
+ * or for sub-blocks starting on a multiple of 8). x holds element start at x[0] and out receives
+ * it at out[0], so the input may be a staging buffer rather than the whole source array.
+ */
+typedef void (*_quantize_block_fn)(const float *x, quantized_array_t *quantized_array,
+                                   uint64_t b, uint64_t start, uint64_t n, _error_sums_t *sums);
+typedef void (*_dequantize_block_fn)(const quantized_array_t *quantized_array,
+                                     uint64_t b, uint64_t start, uint64_t n, float *out);
+
+static inline const uint8_t *_get_q5_high_bits(const quantized_array_t *quantized_array) {
+    return (const uint8_t *)quantized_array->data + (quantized_array->num_elements + 1) / 2;
+}
+
+/* Error statistics of an already encoded block, decoded ERROR_SUB_BLOCK elements at a time. */
+static inline void _measure_block_error(const float *x, const quantized_array_t *quantized_array,
+                                        uint64_t b, uint64_t start, uint64_t n,
+                                        _dequantize_block_fn decode, _error_sums_t *sums) {
+    float y[ERROR_SUB_BLOCK];
+    float block_abs = 0.0f, block_sq = 0.0f, block_signal = 0.0f, block_max = 0.0f;
+
+    for (uint64_t j = 0; j < n; j += ERROR_SUB_BLOCK) {
+        const uint64_t m = (n - j < ERROR_SUB_BLOCK) ? n - j : ERROR_SUB_BLOCK;
+        const float *xs = x + j;
+        decode(quantized_array, b, start + j, m, y);
+#pragma omp simd reduction(+:block_abs, block_sq, block_signal) reduction(max:block_max)
+        for (uint64_t i = 0; i < m; ++i) {
+            const float e  = y[i] - xs[i];
+            const float ae = fabsf(e);
+            block_abs    += ae;
+            block_sq     += e * e;
+            block_signal += xs[i] * xs[i];
+            block_max     = (ae > block_max) ? ae : block_max;
         }
+    }
+    _add_block_error(sums, block_abs, block_sq, block_signal, block_max);
+}
 
-        /* 2) compute scale */
-        float scale = (abs_max > 0.0f) ? (abs_max / 7.0f) : 0.0f;
-        float inv_scale = (scale > 0.0f) ? (1.0f / scale) : 0.0f;
-        quantized_array->scales[b] = scale;
+static inline void _quantize_q8_0_at(const float *x, quantized_array_t *quantized_array,
+                                     uint64_t b, uint64_t start, uint64_t n, _error_sums_t *sums) {
+    quantized_array->scales[b] = _quantize_q8_0_block(x, quantized_array->data + start, n, sums);
+}
 
-        /* 3) quantise */
-        for (uint64_t i = 0; i < remain; ++i) {
-            float val = float_array[start + i] * inv_scale;
-            long qi   = lrintf(val); /* nearest int */
-            if (qi < -7) qi = -7;
-            if (qi >  7) qi =  7;
+static inline void _dequantize_q8_0_at(const quantized_array_t *quantized_array,
+                                       uint64_t b, uint64_t start, uint64_t n, float *out) {
+    _dequantize_q8_0_block(quantized_array->data + start, quantized_array->scales[b], out, n);
+}
 
-            uint8_t four_bit_qi = ((uint8_t)qi) & 0x0F; 
+static inline void _quantize_q4_0_at(const float *x, quantized_array_t *quantized_array,
+                                     uint64_t b, uint64_t start, uint64_t n, _error_sums_t *sums) {
+    quantized_array->scales[b] = _quantize_q4_0_block(x, (uint8_t *)quantized_array->data + start / 2,
+                                                      n, sums);
+}
 
-            int data_index = (start + i) / 2;
-            if (i % 2 == 0) {
-                data[data_index] = (uint8_t)(four_bit_qi << 4);
-            }
-            else {
-                data[data_index] = (uint8_t)(data[data_index] | four_bit_qi);
-            }
+static inline void _dequantize_q4_0_at(const quantized_array_t *quantized_array,
+                                       uint64_t b, uint64_t start, uint64_t n, float *out) {
+    _dequantize_q4_0_block((const uint8_t *)quantized_array->data + start / 2, quantized_array->scales[b],
+                           out, n);
+}
+
+static inline void _dequantize_q4_1_at(const quantized_array_t *quantized_array,
+                                       uint64_t b, uint64_t start, uint64_t n, float *out) {
+    _dequantize_q4_1_block((const uint8_t *)quantized_array->data + start / 2,
+                           quantized_array->scales[2 * b], quantized_array->scales[2 * b + 1], out, n);
+}
+
+static inline void _quantize_q4_1_at(const float *x, quantized_array_t *quantized_array,
+                                     uint64_t b, uint64_t start, uint64_t n, _error_sums_t *sums) {
+    _quantize_q4_1_block(x, (uint8_t *)quantized_array->data + start / 2,
+                         quantized_array->scales + 2 * b, n);
+    if (sums) _measure_block_error(x, quantized_array, b, start, n, _dequantize_q4_1_at, sums);
+}
+
+static inline void _dequantize_q5_0_at(const quantized_array_t *quantized_array,
+                                       uint64_t b, uint64_t start, uint64_t n, float *out) {
+    _dequantize_q5_block((const uint8_t *)quantized_array->data + start / 2,
+                         _get_q5_high_bits(quantized_array) + start / 8,
+                         quantized_array->scales[b], 0.0f, 16.0f, out, n);
+}
+
+/* d = max / -16 maps the element of largest magnitude exactly onto code 0 */
+static inline void _quantize_q5_0_at(const float *x, quantized_array_t *quantized_array,
+                                     uint64_t b, uint64_t start, uint64_t n, _error_sums_t *sums) {
+    const float scale = _block_signed_abs_max(x, n) / -16.0f;
+    const float inv_scale = (scale != 0.0f) ? (1.0f / scale) : 0.0f;
+
+    _quantize_q5_block(x, (uint8_t *)quantized_array->data + start / 2,
+                       (uint8_t *)_get_q5_high_bits(quantized_array) + start / 8,
+                       n, 0.0f, inv_scale, 16.0f);
+    quantized_array->scales[b] = scale;
+    if (sums) _measure_block_error(x, quantized_array, b, start, n, _dequantize_q5_0_at, sums);
+}
+
+static inline void _dequantize_q5_1_at(const quantized_array_t *quantized_array,
+                                       uint64_t b, uint64_t start, uint64_t n, float *out) {
+    _dequantize_q5_block((const uint8_t *)quantized_array->data + start / 2,
+                         _get_q5_high_bits(quantized_array) + start / 8,
+                         quantized_array->scales[2 * b], quantized_array->scales[2 * b + 1], 0.0f, out, n);
+}
+
+static inline void _quantize_q5_1_at(const float *x, quantized_array_t *quantized_array,
+                                     uint64_t b, uint64_t start, uint64_t n, _error_sums_t *sums) {
+    float vmin, vmax;
+    _block_min_max(x, n, &vmin, &vmax);
+    const float scale = (vmax - vmin) / 31.0f;
+    const float inv_scale = (scale > 0.0f) ? (1.0f / scale) : 0.0f;
+
+    _quantize_q5_block(x, (uint8_t *)quantized_array->data + start / 2,
+                       (uint8_t *)_get_q5_high_bits(quantized_array) + start / 8,
+                       n, vmin, inv_scale, 0.0f);
+    quantized_array->scales[2 * b]     = scale;
+    quantized_array->scales[2 * b + 1] = vmin;
+    if (sums) _measure_block_error(x, quantized_array, b, start, n, _dequantize_q5_1_at, sums);
+}
+
+/* q8_0 codes plus s = d * sum(q), which lets a dot product fold in an activation offset */
+static inline void _quantize_q8_1_at(const float *x, quantized_array_t *quantized_array,
+                                     uint64_t b, uint64_t start, uint64_t n, _error_sums_t *sums) {
+    const int8_t *q = quantized_array->data + start;
+    const float scale = _quantize_q8_0_block(x, quantized_array->data + start, n, sums);
+
+    int32_t sum = 0;
+#pragma omp simd reduction(+:sum)
+    for (uint64_t i = 0; i < n; ++i) {
+        sum += q[i];
+    }
+    quantized_array->scales[2 * b]     = scale;
+    quantized_array->scales[2 * b + 1] = scale * (float)sum;
+}
+
+static inline void _dequantize_q8_1_at(const quantized_array_t *quantized_array,
+                                       uint64_t b, uint64_t start, uint64_t n, float *out) {
+    _dequantize_q8_0_block(quantized_array->data + start, quantized_array->scales[2 * b], out, n);
+}
+
+/* indexed by quantized_type; used for the tail block and any other single-block call */
+static const _quantize_block_fn _quantize_block_fns[QUANTIZED_TYPE_COUNT] = {
+    _quantize_q8_0_at, _quantize_q4_0_at, _quantize_q4_1_at,
+    _quantize_q5_0_at, _quantize_q5_1_at, _quantize_q8_1_at,
+};
+
+/* ---- Full-block range kernels --------------------------------------------- */
+
+typedef void (*_quantize_range_fn)(const float *x, quantized_array_t *quantized_array,
+                                   uint64_t first_block, uint64_t end_block, _error_sums_t *sums);
+typedef void (*_dequantize_range_fn)(const quantized_array_t *quantized_array,
+                                     uint64_t first_block, uint64_t end_block, float *out);
+
+typedef struct {
+    uint64_t block_size;            /* 0 for the generic entry */
+    _quantize_range_fn   quantize[QUANTIZED_TYPE_COUNT];      /* indexed by quantized_type */
+    _dequantize_range_fn dequantize[QUANTIZED_TYPE_COUNT];
+} _block_kernels_t;
+
+/*
+ * Full-block range loops. They are written once per format with block_size as an expression and
+ * instantiated below with literal block sizes, so each instance has constant trip counts the
+ * compiler unrolls and vectorizes; the "generic" instance reads the runtime size.
+ * x holds and out receives block first_block at [0].
+ */
+#define DEFINE_FORMAT_KERNELS(format, suffix, block_size_expr)                                      \
+    static void _quantize_##format##_range_##suffix(const float *x,                                 \
+                                                    quantized_array_t *quantized_array,             \
+                                                    uint64_t first_block, uint64_t end_block,       \
+                                                    _error_sums_t *sums) {                          \
+        const uint64_t block_size = (block_size_expr);                                              \
+        for (uint64_t b = first_block; b < end_block; ++b) {                                        \
+            _quantize_##format##_at(x + (b - first_block) * block_size, quantized_array, b,         \
+                                    b * block_size, block_size, sums);                              \
+        }                                                                                           \
+    }                                                                                               \
+    static void _dequantize_##format##_range_##suffix(const quantized_array_t *quantized_array,     \
+                                                      uint64_t first_block, uint64_t end_block,     \
+                                                      float *out) {                                 \
+        const uint64_t block_size = (block_size_expr);                                              \
+        for (uint64_t b = first_block; b < end_block; ++b) {                                        \
+            _dequantize_##format##_at(quantized_array, b, b * block_size, block_size,               \
+                                      out + (b - first_block) * block_size);                        \
+        }                                                                                           \
+    }
+
+#define DEFINE_BLOCK_KERNELS(suffix, block_size_expr)                                               \
+    DEFINE_FORMAT_KERNELS(q8_0, suffix, block_size_expr)                                            \
+    DEFINE_FORMAT_KERNELS(q4_0, suffix, block_size_expr)                                            \
+    DEFINE_FORMAT_KERNELS(q4_1, suffix, block_size_expr)                                            \
+    DEFINE_FORMAT_KERNELS(q5_0, suffix, block_size_expr)                                            \
+    DEFINE_FORMAT_KERNELS(q5_1, suffix, block_size_expr)                                            \
+    DEFINE_FORMAT_KERNELS(q8_1, suffix, block_size_expr)
+
+#define BLOCK_KERNELS_ENTRY(suffix, block_size)                                                     \
+    { block_size,                                                                                   \
+      { _quantize_q8_0_range_##suffix, _quantize_q4_0_range_##suffix,                               \
+        _quantize_q4_1_range_##suffix, _quantize_q5_0_range_##suffix,                               \
+        _quantize_q5_1_range_##suffix, _quantize_q8_1_range_##suffix },                             \
+      { _dequantize_q8_0_range_##suffix, _dequantize_q4_0_range_##suffix,                           \
+        _dequantize_q4_1_range_##suffix, _dequantize_q5_0_range_##suffix,                           \
+        _dequantize_q5_1_range_##suffix, _dequantize_q8_1_range_##suffix } }
+
+DEFINE_BLOCK_KERNELS(16, 16)
+DEFINE_BLOCK_KERNELS(32, 32)
+DEFINE_BLOCK_KERNELS(64, 64)
+DEFINE_BLOCK_KERNELS(128, 128)
+DEFINE_BLOCK_KERNELS(generic, quantized_array->block_size)
+
+static const _block_kernels_t _specialized_block_kernels[] = {
+    BLOCK_KERNELS_ENTRY(16, 16),
+    BLOCK_KERNELS_ENTRY(32, 32),
+    BLOCK_KERNELS_ENTRY(64, 64),
+    BLOCK_KERNELS_ENTRY(128, 128),
+};
+
+static const _block_kernels_t _generic_block_kernels = BLOCK_KERNELS_ENTRY(generic, 0);
+
+static const _block_kernels_t *_select_block_kernels(uint64_t block_size) {
+    const size_t count = sizeof(_specialized_block_kernels) / sizeof(_specialized_block_kernels[0]);
+    for (size_t i = 0; i < count; ++i) {
+        if (_specialized_block_kernels[i].block_size == block_size) return &_specialized_block_kernels[i];
+    }
+    return &_generic_block_kernels;
+}
+
+/* Single tail handler: the last block when num_elements is not a multiple of block_size. */
+static void _quantize_tail_block(const float *float_array, quantized_array_t *quantized_array,
+                                 _error_sums_t *sums) {
+    const uint64_t b      = quantized_array->num_blocks - 1;
+    const uint64_t start  = b * quantized_array->block_size;
+    const uint64_t remain = quantized_array->num_elements - start;
+
+    _quantize_block_fns[quantized_array->quantized_type](float_array + start, quantized_array, b, start, remain,
+                                                         sums);
+}
+
+/* Decodes a single element with the same arithmetic as the block kernels. */
+static float _dequantize_element(const quantized_array_t *quantized_array, uint64_t e) {
+    const uint64_t b = e / quantized_array->block_size;
+    const float *scales = quantized_array->scales;
+    const uint8_t *data = (const uint8_t *)quantized_array->data;
+    const uint8_t nibble = (e % 2 == 0) ? (data[e / 2] >> 4) : (data[e / 2] & 0x0F);
+
+    switch (quantized_array->quantized_type) {
+        case 0: /* q8_0 */
+            return scales[b] * (float)quantized_array->data[e];
+        case 1: /* q4_0 */
+            return scales[b] * (float)((int8_t)(nibble << 4) >> 4);
+        case 2: /* q4_1 */
+            return _q4_1_value(scales[2 * b], scales[2 * b + 1], nibble);
+        case 3: /* q5_0 */
+        case 4: { /* q5_1 */
+            const uint8_t high = (_get_q5_high_bits(quantized_array)[e / 8] >> (e % 8)) & 1;
+            const uint8_t q = (uint8_t)(nibble | (high << 4));
+            return (quantized_array->quantized_type == 3)
+                     ? _q5_value(scales[b], 0.0f, 16.0f, q)
+                     : _q5_value(scales[2 * b], scales[2 * b + 1], 0.0f, q);
+        }
+        default: /* q8_1 */
+            return scales[2 * b] * (float)quantized_array->data[e];
+    }
+}
+
+/*
+ * Element-wise decode of [first_element, end_element), used for blocks only partially covered by
+ * a requested range. It is also the single tail handler for a final partial block on decode.
+ */
+static void _dequantize_partial_blocks(const quantized_array_t *quantized_array,
+                                       uint64_t first_element, uint64_t end_element, float *out) {
+    for (uint64_t e = first_element; e < end_element; ++e) {
+        out[e - first_element] = _dequantize_element(quantized_array, e);
+    }
+}
+
+/* ---- Quantization / Dequantization -------------------------------------- */
+
+static int _quantize_into(const float *float_array,
+                          quantized_array_t *quantized_array,
+                          codec_metrics_t *metrics) {
+    const uint8_t quantized_type = quantized_array->quantized_type;
+    if (quantized_type >= QUANTIZED_TYPE_COUNT) return 1; /* unknown type */
+
+    const _quantize_range_fn kernel = _select_block_kernels(quantized_array->block_size)->quantize[quantized_type];
+    const uint64_t num_full_blocks = quantized_array->num_elements / quantized_array->block_size;
+
+    /* a tuned profile may shrink the team for small arrays or change the scheduling step */
+    autotune_config_t config;
+    _get_quantize_config(quantized_type, quantized_array->num_elements, &config);
+    const uint64_t chunk_blocks = config.chunk;
+    const uint64_t num_chunks = (num_full_blocks + chunk_blocks - 1) / chunk_blocks;
+
+    double sum_abs = 0.0, sum_sq = 0.0, sum_signal = 0.0, max_abs = 0.0;
+
+#pragma omp parallel num_threads(config.num_threads) if(config.num_threads > 1 && num_chunks > 1) \
+        reduction(+:sum_abs, sum_sq, sum_signal) reduction(max:max_abs)
+    {
+        numa_bind_worker((uint32_t)omp_get_thread_num(), (uint32_t)omp_get_num_threads());
+        _error_sums_t sums = {0.0, 0.0, 0.0, 0.0};
+
+#pragma omp for schedule(static)
+        for (uint64_t chunk = 0; chunk < num_chunks; ++chunk) {
+            const uint64_t first_block = chunk * chunk_blocks;
+            const uint64_t end_block = (first_block + chunk_blocks < num_full_blocks)
+                                         ? first_block + chunk_blocks
+                                         : num_full_blocks;
+            kernel(float_array + first_block * quantized_array->block_size, quantized_array, first_block, end_block,
+                   metrics ? &sums : NULL);
         }
+
+        sum_abs    += sums.sum_abs;
+        sum_sq     += sums.sum_sq;
+        sum_signal += sums.sum_signal;
+        if (sums.max_abs > max_abs) max_abs = sums.max_abs;
+        numa_release_worker((uint32_t)omp_get_thread_num());
+    }
+
+    if (num_full_blocks < quantized_array->num_blocks) {
+        _error_sums_t sums = {0.0, 0.0, 0.0, 0.0};
+        _quantize_tail_block(float_array, quantized_array, metrics ? &sums : NULL);
+        sum_abs    += sums.sum_abs;
+        sum_sq     += sums.sum_sq;
+        sum_signal += sums.sum_signal;
+        if (sums.max_abs > max_abs) max_abs = sums.max_abs;
     }
+
+    if (metrics) codec_metrics_finalize(sum_abs, sum_sq, max_abs, sum_signal, quantized_array->num_elements, metrics);
     return 0;
 }
 
+/* An array of quantized_type with its default block size, NULL for an unknown type. */
+static quantized_array_t *_allocate_default_array(uint8_t quantized_type, uint64_t num_elements) {
+    switch (quantized_type) {
+        case 0: /* q8_0 */
+            return allocate_q8_0_array(num_elements, DEFAULT_Q8_0_BLOCK_SIZE);
+        case 1: /* q4_0 */
+            return allocate_q4_0_array(num_elements, DEFAULT_Q4_0_BLOCK_SIZE);
+        case 2: /* q4_1 */
+            return allocate_q4_1_array(num_elements, DEFAULT_Q4_1_BLOCK_SIZE);
+        case 3: /* q5_0 */
+            return allocate_q5_0_array(num_elements, DEFAULT_Q5_0_BLOCK_SIZE);
+        case 4: /* q5_1 */
+            return allocate_q5_1_array(num_elements, DEFAULT_Q5_1_BLOCK_SIZE);
+        case 5: /* q8_1 */
+            return allocate_q8_1_array(num_elements, DEFAULT_Q8_1_BLOCK_SIZE);
+        default:
+            return NULL; /* unknown type */
+    }
+}
+
+static int _quantize(const float *float_array,
+                     uint64_t num_elements,
+                     uint8_t quantized_type,
+                     quantized_array_t **quantized_array,
+                     codec_metrics_t *metrics) {
+    *quantized_array = _allocate_default_array(quantized_type, num_elements);
+    if (!*quantized_array) return 1;
+    return _quantize_into(float_array, *quantized_array, metrics);
+}
+
 int quantize(const float *float_array,
              uint64_t num_elements,
              uint8_t quantized_type,
              quantized_array_t **quantized_array) {
+    return quantize_with_metrics(float_array, num_elements, quantized_type, quantized_array, NULL);
+}
+
+int quantize_with_metrics(const float *float_array,
+                          uint64_t num_elements,
+                          uint8_t quantized_type,
+                          quantized_array_t **quantized_array,
+                          codec_metrics_t *metrics) {
     if (!float_array || num_elements == 0 || *quantized_array) return 1;
 
-    switch (quantized_type) {
-        case 0: /* q8_0 */
-            *quantized_array = allocate_q8_0_array(num_elements,
-                                                   DEFAULT_Q8_0_BLOCK_SIZE);
-            if (!*quantized_array) return 1;
-            return _quantize_q8_0(float_array, *quantized_array);
+    CODEC_PROFILE_BEGIN(CODEC_OP_QUANTIZE, quantized_type, num_elements);
+    int ret = _quantize(float_array, num_elements, quantized_type, quantized_array, metrics);
+    CODEC_PROFILE_END(CODEC_OP_QUANTIZE, quantized_type, num_elements,
+                      num_elements * sizeof(float),
+                      ret ? 0 : (uint64_t)get_quantized_array_size(*quantized_array));
+    return ret;
+}
 
-        case 1: /* q4_0 */
-            *quantized_array = allocate_q4_0_array(num_elements,
-                                                   DEFAULT_Q4_0_BLOCK_SIZE);
-            if (!*quantized_array) return 1;
-            return _quantize_q4_0(float_array, *quantized_array);
-        default:
-            return 1; /* unknown type */
+int quantize_into(const float *float_array,
+                  quantized_array_t *quantized_array,
+                  codec_metrics_t *metrics) {
+    if (!float_array || !quantized_array) return 1;
+    if (quantized_array->rotation_size) return 1;  /* decodes would rotate plain data back */
+
+    CODEC_PROFILE_BEGIN(CODEC_OP_QUANTIZE, quantized_array->quantized_type, quantized_array->num_elements);
+    int ret = _quantize_into(float_array, quantized_array, metrics);
+    CODEC_PROFILE_END(CODEC_OP_QUANTIZE, quantized_array->quantized_type, quantized_array->num_elements,
+                      quantized_array->num_elements * sizeof(float),
+                      ret ? 0 : (uint64_t)get_quantized_array_size(quantized_array));
+    return ret;
+}
+
+/* Decodes [first_element, end_element) on the calling thread: whole blocks through the kernel, ragged ends element-wise. */
+static void _dequantize_span(const quantized_array_t *quantized_array, _dequantize_range_fn kernel,
+                             uint64_t first_element, uint64_t end_element, float *out) {
+    const uint64_t block_size  = quantized_array->block_size;
+    const uint64_t first_block = (first_element + block_size - 1) / block_size;
+    const uint64_t end_block   = end_element / block_size;
+    if (first_block >= end_block) {
+        _dequantize_partial_blocks(quantized_array, first_element, end_element, out);
+        return;
     }
+
+    kernel(quantized_array, first_block, end_block, out + (first_block * block_size - first_element));
+    _dequantize_partial_blocks(quantized_array, first_element, first_block * block_size, out);
+    _dequantize_partial_blocks(quantized_array, end_block * block_size, end_element,
+                               out + (end_block * block_size - first_element));
 }
 
-static int _dequantize_q8_0(const quantized_array_t *quantized_array, 
-                            float *float_array) {
-    const uint64_t block_size   = quantized_array->block_size;
-    const uint64_t num_blocks   = quantized_array->num_blocks;
-    const uint64_t num_elements = quantized_array->num_elements;
+/* Decodes [first_element, first_element + num_elements) into out, touching only the covering blocks. */
+static int _dequantize_range(const quantized_array_t *quantized_array,
+                             uint64_t first_element, uint64_t num_elements, float *out) {
+    const uint8_t quantized_type = quantized_array->quantized_type;
+    if (quantized_type >= QUANTIZED_TYPE_COUNT) return 1; /* unknown type */
 
-    for (uint64_t b = 0; b < num_blocks; ++b) {
-        const uint64_t start = b * block_size;
-        const uint64_t remain = (start + block_size <= num_elements)
-                                  ? block_size
-                                  : (num_elements - start);
-        const float scale = quantized_array->scales[b];
+    const _dequantize_range_fn kernel = _select_block_kernels(quantized_array->block_size)->dequantize[quantized_type];
+    const uint64_t rotation_size = quantized_array->rotation_size;
+    const uint64_t end_element = first_element + num_elements;
 
-        for (uint64_t i = 0; i < remain; ++i) {
-            float_array[start + i] = scale * (float)quantized_array->data[start + i];
+    /* a rotated array decodes whole rotation blocks; a slice that cuts one is staged and copied out */
+    uint64_t first = first_element, end = end_element;
+    float *target = out;
+    if (rotation_size) {
+        first = first_element / rotation_size * rotation_size;
+        end   = (end_element + rotation_size - 1) / rotation_size * rotation_size;
+        if (first != first_element || end != end_element) {
+            target = malloc((end - first) * sizeof(float));
+            if (!target) return 1;
         }
     }
+
+    /* tiles of KERNEL_CHUNK_BLOCKS blocks (whole rotation blocks when rotated) at absolute positions */
+    uint64_t tile = KERNEL_CHUNK_BLOCKS * quantized_array->block_size;
+    if (rotation_size) tile = (tile + rotation_size - 1) / rotation_size * rotation_size;
+    const uint64_t first_tile = first / tile;
+    const uint64_t end_tile   = (end + tile - 1) / tile;
+
+#pragma omp parallel for if(end_tile - first_tile > 1) schedule(static)
+    for (uint64_t t = first_tile; t < end_tile; ++t) {
+        const uint64_t tile_first = (t * tile > first) ? t * tile : first;
+        const uint64_t tile_end   = ((t + 1) * tile < end) ? (t + 1) * tile : end;
+        float *tile_out = target + (tile_first - first);
+        _dequantize_span(quantized_array, kernel, tile_first, tile_end, tile_out);
+        /* inverse rotation fused in while the decoded tile is still in cache */
+        if (rotation_size) hadamard_transform_local(tile_out, tile_end - tile_first, rotation_size);
+    }
+
+    if (target != out) {
+        memcpy(out, target + (first_element - first), num_elements * sizeof(float));
+        free(target);
+    }
     return 0;
 }
 
-static int _dequantize_q4_0(const quantized_array_t *quantized_array, 
-                            float *float_array) {
-    const uint64_t block_size   = quantized_array->block_size;
-    const uint64_t num_blocks   = quantized_array->num_blocks;
+/* ---- Rotated quantization ----------------------------------------------- */
+
+static uint64_t _gcd(uint64_t a, uint64_t b) {
+    while (b) {
+        const uint64_t r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+/*
+ * Rotates one tile of whole rotation blocks into a per-thread scratch buffer and quantizes it
+ * from there, so no full-size rotated copy of the input is ever held. With metrics, the tile is
+ * decoded and rotated back and compared with the original input, i.e. the error dequantize shows.
+ */
+static int _quantize_rotated_into(const float *float_array, quantized_array_t *quantized_array,
+                                  uint64_t rotation_size, codec_metrics_t *metrics) {
+    const uint8_t quantized_type = quantized_array->quantized_type;
     const uint64_t num_elements = quantized_array->num_elements;
-    const uint8_t *src_data = (const uint8_t *)quantized_array->data;
-
-    for (uint64_t b = 0; b < num_blocks; ++b) {
-        const uint64_t start = b * block_size;
-        const uint64_t remain = (start + block_size <= num_elements)
-                                  ? block_size
-                                  : (num_elements - start);
-        const float scale = quantized_array->scales[b];
-
-        for (uint64_t i = 0; i < remain; ++i) {
-            int data_index = (start + i) / 2;
-            uint8_t packed_qi = src_data[data_index];
-
-            if (i % 2 == 0) {
-                uint8_t qi = packed_qi >> 4;
-                int8_t signed_qi = (int8_t)(qi << 4) >> 4;
-                float_array[start + i] = scale * (float)(signed_qi);
+    const uint64_t block_size = quantized_array->block_size;
+    const _block_kernels_t *kernels = _select_block_kernels(block_size);
+
+    /* whole rotation blocks and whole quantization blocks, so only the last tile has a partial block */
+    const uint64_t step = rotation_size / _gcd(rotation_size, block_size) * block_size;
+    const uint64_t tile = (ROTATION_TILE_ELEMENTS + step - 1) / step * step;
+    const uint64_t num_tiles = (num_elements + tile - 1) / tile;
+
+    /* the team first touch used, so each thread's tiles sit roughly on its own node's pages */
+    autotune_config_t config;
+    _get_quantize_config(quantized_type, num_elements, &config);
+
+    double sum_abs = 0.0, sum_sq = 0.0, sum_signal = 0.0, max_abs = 0.0;
+    int failed = 0;
+
+#pragma omp parallel num_threads(config.num_threads) if(config.num_threads > 1 && num_tiles > 1) \
+        reduction(+:sum_abs, sum_sq, sum_signal) reduction(max:max_abs) reduction(|:failed)
+    {
+        numa_bind_worker((uint32_t)omp_get_thread_num(), (uint32_t)omp_get_num_threads());
+        float *rotated  = malloc(tile * sizeof(float));
+        float *restored = metrics ? malloc(tile * sizeof(float)) : NULL;
+        failed = !rotated || (metrics && !restored);
+
+#pragma omp for schedule(static)
+        for (uint64_t t = 0; t < num_tiles; ++t) {
+            if (failed) continue;
+            const uint64_t start = t * tile;
+            const uint64_t n = (start + tile < num_elements) ? tile : num_elements - start;
+            const uint64_t first_block = start / block_size;
+            const uint64_t num_full = n / block_size;
+
+            memcpy(rotated, float_array + start, n * sizeof(float));
+            hadamard_transform_local(rotated, n, rotation_size);
+            kernels->quantize[quantized_type](rotated, quantized_array, first_block, first_block + num_full, NULL);
+            if (n % block_size) {
+                _quantize_block_fns[quantized_type](rotated + num_full * block_size, quantized_array,
+                                                    first_block + num_full, start + num_full * block_size,
+                                                    n % block_size, NULL);
             }
-            else {
-                uint8_t qi = packed_qi & 0x0F;
-                int8_t signed_qi = (int8_t)(qi << 4) >> 4;
-                float_array[start + i] = scale * (float)(signed_qi);
+            if (!metrics) continue;
+
+            _dequantize_span(quantized_array, kernels->dequantize[quantized_type], start, start + n, restored);
+            hadamard_transform_local(restored, n, rotation_size);
+            const float *x = float_array + start;
+            double tile_max = 0.0;
+#pragma omp simd reduction(+:sum_abs, sum_sq, sum_signal) reduction(max:tile_max)
+            for (uint64_t i = 0; i < n; ++i) {
+                const double e  = (double)restored[i] - (double)x[i];
+                const double ae = fabs(e);
+                sum_abs    += ae;
+                sum_sq     += e * e;
+                sum_signal += (double)x[i] * x[i];
+                tile_max    = (ae > tile_max) ? ae : tile_max;
             }
+            if (tile_max > max_abs) max_abs = tile_max;
         }
-    }   
-    return 0;
+
+        free(rotated);
+        free(restored);
+        numa_release_worker((uint32_t)omp_get_thread_num());
+    }
+
+    if (!failed && metrics) codec_metrics_finalize(sum_abs, sum_sq, max_abs, sum_signal, num_elements, metrics);
+    return failed;
+}
+
+int quantize_rotated(const float *float_array,
+                     uint64_t num_elements,
+                     uint64_t num_features,
+                     uint8_t quantized_type,
+                     quantized_array_t **quantized_array) {
+    return quantize_rotated_with_metrics(float_array, num_elements, num_features, quantized_type,
+                                         quantized_array, NULL);
+}
+
+int quantize_rotated_with_metrics(const float *float_array,
+                                  uint64_t num_elements,
+                                  uint64_t num_features,
+                                  uint8_t quantized_type,
+                                  quantized_array_t **quantized_array,
+                                  codec_metrics_t *metrics) {
+    if (!float_array || num_elements == 0 || num_features == 0 || *quantized_array) return 1;
+    if (num_elements % num_features) return 1;
+
+    const uint64_t rotation_size = hadamard_block_size(num_features);
+    if (rotation_size < HADAMARD_MIN_BLOCK_SIZE) return 1;     /* would spread nothing */
+
+    CODEC_PROFILE_BEGIN(CODEC_OP_QUANTIZE, quantized_type, num_elements);
+    *quantized_array = _allocate_default_array(quantized_type, num_elements);
+    int ret = !*quantized_array || _quantize_rotated_into(float_array, *quantized_array, rotation_size, metrics);
+    if (ret) {
+        free_quantized_array(*quantized_array);
+        *quantized_array = NULL;
+    } else {
+        (*quantized_array)->rotation_size = (uint32_t)rotation_size;
+    }
+
+    CODEC_PROFILE_END(CODEC_OP_QUANTIZE, quantized_type, num_elements,
+                      num_elements * sizeof(float),
+                      ret ? 0 : (uint64_t)get_quantized_array_size(*quantized_array));
+    return ret;
 }
 
+/* Encoded bytes (scales + data) of the blocks covering [first_element, end_element). */
+static uint64_t _get_range_size(const quantized_array_t *quantized_array,
+                                uint64_t first_element, uint64_t end_element) {
+    const uint64_t block_size  = quantized_array->block_size;
+    const uint64_t first_block = first_element / block_size;
+    const uint64_t end_block   = (end_element + block_size - 1) / block_size;
+    const uint64_t span_end    = (end_block * block_size < quantized_array->num_elements)
+                                   ? end_block * block_size
+                                   : quantized_array->num_elements;
+    const uint64_t span = span_end - first_block * block_size;
+    const uint8_t quantized_type = quantized_array->quantized_type;
+    return (end_block - first_block) * _get_scales_per_block(quantized_type) * sizeof(float)
+         + _get_data_size(quantized_type, span);
+}
 
 int dequantize(const quantized_array_t *quantized_array, float *float_array) {
     if (!quantized_array || !float_array) return 1;
 
-    switch (quantized_array->quantized_type) {
-        case 0: /* q8_0 */
-            return _dequantize_q8_0(quantized_array, float_array);
+    CODEC_PROFILE_BEGIN(CODEC_OP_DEQUANTIZE, quantized_array->quantized_type, quantized_array->num_elements);
+    int ret = _dequantize_range(quantized_array, 0, quantized_array->num_elements, float_array);
+    CODEC_PROFILE_END(CODEC_OP_DEQUANTIZE, quantized_array->quantized_type, quantized_array->num_elements,
+                      (uint64_t)get_quantized_array_size(quantized_array),
+                      ret ? 0 : quantized_array->num_elements * sizeof(float));
+    return ret;
+}
 
-        case 1: /* q4_0 */
-            return _dequantize_q4_0(quantized_array, float_array);
-        default:
-            return 1; /* unknown type */
+int dequantize_range(const quantized_array_t *quantized_array,
+                     uint64_t first_element,
+                     uint64_t num_elements,
+                     float *float_array) {
+    if (!quantized_array || !float_array || num_elements == 0) return 1;
+    if (first_element > quantized_array->num_elements ||
+        num_elements > quantized_array->num_elements - first_element) return 1;
+
+    CODEC_PROFILE_BEGIN(CODEC_OP_DEQUANTIZE, quantized_array->quantized_type, num_elements);
+    int ret = _dequantize_range(quantized_array, first_element, num_elements, float_array);
+    CODEC_PROFILE_END(CODEC_OP_DEQUANTIZE, quantized_array->quantized_type, num_elements,
+                      _get_range_size(quantized_array, first_element, first_element + num_elements),
+                      ret ? 0 : num_elements * sizeof(float));
+    return ret;
+}
+
+int dequantize_rows(const quantized_array_t *quantized_array,
+                    uint64_t num_features,
+                    uint64_t first_token,
+                    uint64_t num_tokens,
+                    float *float_array) {
+    if (!quantized_array || num_features == 0 || quantized_array->num_elements % num_features) return 1;
+    if (first_token > UINT64_MAX / num_features || num_tokens > UINT64_MAX / num_features) return 1;
+    return dequantize_range(quantized_array, first_token * num_features, num_tokens * num_features, float_array);
+}
+
+/* ---- Per-token (row-wise) quantization ---------------------------------- */
+
+static uint64_t _get_token_row_data_size(uint8_t quantized_type, uint16_t num_features) {
+    return (quantized_type == 1) ? ((uint64_t)num_features + 1) / 2 : num_features;
+}
+
+token_quantized_array_t *allocate_token_quantized_array(uint16_t num_tokens,
+                                                        uint16_t num_features,
+                                                        uint8_t quantized_type,
+                                                        uint16_t group_size) {
+    if (!num_tokens || !num_features || quantized_type > 1) return NULL;
+    if (!group_size || group_size > num_features) group_size = num_features;
+    /* q4_0 groups must start on a byte boundary; only a single group may be odd */
+    if (quantized_type == 1 && group_size % 2 && group_size != num_features) return NULL;
+
+    uint16_t num_groups = (uint16_t)((num_features + group_size - 1) / group_size);
+    uint64_t row_size = num_groups * sizeof(float) + _get_token_row_data_size(quantized_type, num_features);
+    row_size = (row_size + sizeof(float) - 1) / sizeof(float) * sizeof(float);   /* keep every row's scales aligned */
+
+    size_t total = sizeof(token_quantized_array_t) + (size_t)num_tokens * row_size;
+    token_quantized_array_t *ta = (token_quantized_array_t*)calloc(1, total);
+    if (!ta) return NULL;
+
+    ta->quantized_type = quantized_type;
+    ta->num_tokens     = num_tokens;
+    ta->num_features   = num_features;
+    ta->group_size     = group_size;
+    ta->num_groups     = num_groups;
+    ta->row_size       = row_size;
+    ta->rows           = (uint8_t*)(ta + 1);
+
+    return ta;
+}
+
+void free_token_quantized_array(token_quantized_array_t *token_array) {
+    if (!token_array) return;
+    free(token_array);
+}
+
+uint64_t get_token_quantized_array_size(const token_quantized_array_t *token_array) {
+    if (!token_array) return 0;
+    return sizeof(token_quantized_array_t) + (uint64_t)token_array->num_tokens * token_array->row_size;
+}
+
+token_quantized_array_t *load_token_quantized_array_from_buffer(const void *buffer, uint64_t buffer_size) {
+    if (!buffer || buffer_size < sizeof(token_quantized_array_t)) return NULL;
+
+    token_quantized_array_t *token_array = (token_quantized_array_t*)calloc(1, buffer_size);
+    if (!token_array) return NULL;
+
+    memcpy(token_array, buffer, buffer_size);
+    if (token_array->quantized_type > 1 || get_token_quantized_array_size(token_array) > buffer_size) {
+        free(token_array);
+        return NULL;
+    }
+    token_array->rows = (uint8_t*)(token_array + 1);
+    return token_array;
+}
+
+/* Encodes one token row: [group scales][packed values], each group a q8_0 / q4_0 block. */
+static void _quantize_token_row(const float *row, const token_quantized_array_t *token_array, uint8_t *dst) {
+    float *scales = (float *)dst;
+    uint8_t *data = dst + token_array->num_groups * sizeof(float);
+    const uint64_t group_size = token_array->group_size;
+
+    for (uint16_t g = 0; g < token_array->num_groups; ++g) {
+        const uint64_t start = (uint64_t)g * group_size;
+        const uint64_t n = (start + group_size <= token_array->num_features)
+                             ? group_size
+                             : token_array->num_features - start;
+        scales[g] = (token_array->quantized_type == 0)
+                      ? _quantize_q8_0_block(row + start, (int8_t *)data + start, n, NULL)
+                      : _quantize_q4_0_block(row + start, data + start / 2, n, NULL);
+    }
+}
+
+static void _dequantize_token_row(const token_quantized_array_t *token_array, const uint8_t *src, float *row) {
+    const float *scales = (const float *)src;
+    const uint8_t *data = src + token_array->num_groups * sizeof(float);
+    const uint64_t group_size = token_array->group_size;
+
+    for (uint16_t g = 0; g < token_array->num_groups; ++g) {
+        const uint64_t start = (uint64_t)g * group_size;
+        const uint64_t n = (start + group_size <= token_array->num_features)
+                             ? group_size
+                             : token_array->num_features - start;
+        if (token_array->quantized_type == 0)
+            _dequantize_q8_0_block((const int8_t *)data + start, scales[g], row + start, n);
+        else
+            _dequantize_q4_0_block(data + start / 2, scales[g], row + start, n);
+    }
+}
+
+int quantize_tokens(const float *float_array,
+                    uint16_t num_tokens,
+                    uint16_t num_features,
+                    uint8_t quantized_type,
+                    uint16_t group_size,
+                    token_quantized_array_t **token_array) {
+    if (!float_array || num_tokens == 0 || num_features == 0 || *token_array) return 1;
+
+    const uint64_t num_elements = (uint64_t)num_tokens * num_features;
+    CODEC_PROFILE_BEGIN(CODEC_OP_QUANTIZE, TOKEN_PROFILE_FORMAT(quantized_type), num_elements);
+
+    *token_array = allocate_token_quantized_array(num_tokens, num_features, quantized_type, group_size);
+    if (!*token_array) {
+        CODEC_PROFILE_END(CODEC_OP_QUANTIZE, TOKEN_PROFILE_FORMAT(quantized_type), num_elements,
+                          num_elements * sizeof(float), 0);
+        return 1;
+    }
+
+    const token_quantized_array_t *ta = *token_array;
+#pragma omp parallel for schedule(static)
+    for (uint16_t t = 0; t < num_tokens; ++t) {
+        _quantize_token_row(float_array + (uint64_t)t * num_features, ta, ta->rows + (uint64_t)t * ta->row_size);
     }
+
+    CODEC_PROFILE_END(CODEC_OP_QUANTIZE, TOKEN_PROFILE_FORMAT(quantized_type), num_elements,
+                      num_elements * sizeof(float), get_token_quantized_array_size(ta));
+    return 0;
+}
+
+int dequantize_tokens(const token_quantized_array_t *token_array, float *float_array) {
+    if (!token_array || !float_array) return 1;
+
+    const uint64_t num_elements = (uint64_t)token_array->num_tokens * token_array->num_features;
+    CODEC_PROFILE_BEGIN(CODEC_OP_DEQUANTIZE, TOKEN_PROFILE_FORMAT(token_array->quantized_type), num_elements);
+
+#pragma omp parallel for schedule(static)
+    for (uint16_t t = 0; t < token_array->num_tokens; ++t) {
+        _dequantize_token_row(token_array, token_array->rows + (uint64_t)t * token_array->row_size,
+                              float_array + (uint64_t)t * token_array->num_features);
+    }
+
+    CODEC_PROFILE_END(CODEC_OP_DEQUANTIZE, TOKEN_PROFILE_FORMAT(token_array->quantized_type), num_elements,
+                      get_token_quantized_array_size(token_array), num_elements * sizeof(float));
+    return 0;
+}
+
+int quantize_token_row(const float *row, token_quantized_array_t *token_array, uint16_t token_index) {
+    if (!row || !token_array || token_index >= token_array->num_tokens) return 1;
+
+    CODEC_PROFILE_BEGIN(CODEC_OP_QUANTIZE, TOKEN_PROFILE_FORMAT(token_array->quantized_type), token_array->num_features);
+    _quantize_token_row(row, token_array, token_array->rows + (uint64_t)token_index * token_array->row_size);
+    CODEC_PROFILE_END(CODEC_OP_QUANTIZE, TOKEN_PROFILE_FORMAT(token_array->quantized_type), token_array->num_features,
+                      (uint64_t)token_array->num_features * sizeof(float), token_array->row_size);
+    return 0;
+}
+
+int dequantize_token_row(const token_quantized_array_t *token_array, uint16_t token_index, float *row) {
+    if (!row || !token_array || token_index >= token_array->num_tokens) return 1;
+
+    CODEC_PROFILE_BEGIN(CODEC_OP_DEQUANTIZE, TOKEN_PROFILE_FORMAT(token_array->quantized_type), token_array->num_features);
+    _dequantize_token_row(token_array, token_array->rows + (uint64_t)token_index * token_array->row_size, row);
+    CODEC_PROFILE_END(CODEC_OP_DEQUANTIZE, TOKEN_PROFILE_FORMAT(token_array->quantized_type), token_array->num_features,
+                      token_array->row_size, (uint64_t)token_array->num_features * sizeof(float));
+    return 0;
 }
@@ -1,5 +1,187 @@
 #include "random.h"
 
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+
+#define RANDOM_BATCH_GROUPS 256     /* philox blocks (4 outputs each) generated per batch */
+#define RANDOM_TWO_PI 6.28318530717958647692f
+#define RANDOM_U24 (1.0f / 16777216.0f)
+#define RANDOM_U23 (1.0f / 8388608.0f)
+
+/* Philox4x32-10 on counter (c0, c1, c2, 0) with key (k0, k1), outputs x[0..3]. */
+static inline void _philox4x32_10(uint32_t c0, uint32_t c1, uint32_t c2,
+                                  uint32_t k0, uint32_t k1, uint32_t x[4]) {
+    uint32_t x0 = c0, x1 = c1, x2 = c2, x3 = 0;
+    for (int r = 0; r < 10; ++r) {
+        const uint64_t p0 = (uint64_t)PHILOX_M0 * x0;
+        const uint64_t p1 = (uint64_t)PHILOX_M1 * x2;
+        const uint32_t y0 = (uint32_t)(p1 >> 32) ^ x1 ^ k0;
+        const uint32_t y2 = (uint32_t)(p0 >> 32) ^ x3 ^ k1;
+        x1 = (uint32_t)p1;
+        x3 = (uint32_t)p0;
+        x0 = y0;
+        x2 = y2;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    x[0] = x0; x[1] = x1; x[2] = x2; x[3] = x3;
+}
+
+/* uniform in [0, 1) from the top 24 bits */
+static inline float _u01(uint32_t x) {
+    return (float)(x >> 8) * RANDOM_U24;
+}
+
+/* uniform in (0, 1), safe for log() and its mirror log(1 - u); 23 bits keep 1 - 2^-24 exact */
+static inline float _u01_open(uint32_t x) {
+    return ((float)(x >> 9) + 0.5f) * RANDOM_U23;
+}
+
+/* Per-channel magnitude multipliers of RANDOM_ACTIVATION, drawn from stream 1 of the seed. */
+static float *_gen_channel_scales(const random_config_t *config, uint32_t k0, uint32_t k1) {
+    float *channel_scales = malloc(config->num_features * sizeof(float));
+    if (!channel_scales) return NULL;
+
+#pragma omp parallel for
+    for (uint64_t c = 0; c < config->num_features; ++c) {
+        uint32_t x[4];
+        _philox4x32_10((uint32_t)c, (uint32_t)(c >> 32), 1u, k0, k1, x);
+        channel_scales[c] = (_u01(x[0]) < config->outlier_ratio) ? config->outlier_scale : 1.0f;
+    }
+    return channel_scales;
+}
+
+/* Turns one batch of raw philox output (4 words per group) into samples, in place order. */
+static void _transform_batch(const uint32_t *bits, float *out, uint64_t num_groups,
+                             const random_config_t *config) {
+    const uint64_t n = num_groups * 4;
+
+    switch (config->distribution) {
+        case RANDOM_UNIFORM: {
+            const float minv = config->minv;
+            const float range = config->maxv - config->minv;
+#pragma omp simd
+            for (uint64_t i = 0; i < n; ++i) {
+                out[i] = minv + _u01(bits[i]) * range;
+            }
+            break;
+        }
+        case RANDOM_NORMAL: {
+            /* Box-Muller: lanes (0, 1) and (2, 3) of every group form one pair each */
+            const float mean = config->mean;
+            const float stddev = config->stddev;
+#pragma omp simd
+            for (uint64_t i = 0; i < n; i += 2) {
+                const float r     = sqrtf(-2.0f * logf(_u01_open(bits[i])));
+                const float theta = RANDOM_TWO_PI * _u01(bits[i + 1]);
+                out[i]     = mean + stddev * r * cosf(theta);
+                out[i + 1] = mean + stddev * r * sinf(theta);
+            }
+            break;
+        }
+        case RANDOM_ACTIVATION: {
+            /* Laplace with the same variance as normal(0, stddev) */
+            const float b = config->stddev * 0.70710678f;
+#pragma omp simd
+            for (uint64_t i = 0; i < n; ++i) {
+                const float v = _u01_open(bits[i]) - 0.5f;
+                const float mag = -b * logf(1.0f - 2.0f * fabsf(v));
+                out[i] = (v < 0.0f) ? -mag : mag;
+            }
+            break;
+        }
+    }
+}
+
+int fill_random_float_array(float *float_array,
+                            uint64_t num_elements,
+                            const random_config_t *config,
+                            uint64_t seed,
+                            uint64_t offset) {
+    if (!float_array || !num_elements || !config) return 1;
+    switch (config->distribution) {
+        case RANDOM_UNIFORM:
+            if (!isfinite(config->minv) || !isfinite(config->maxv) || config->maxv < config->minv) return 1;
+            break;
+        case RANDOM_NORMAL:
+            if (!isfinite(config->mean) || !isfinite(config->stddev) || config->stddev < 0.0f) return 1;
+            break;
+        case RANDOM_ACTIVATION:
+            if (!config->num_features || !isfinite(config->stddev) || config->stddev < 0.0f) return 1;
+            break;
+        default:
+            return 1; /* unknown distribution */
+    }
+
+    const uint32_t k0 = (uint32_t)seed;
+    const uint32_t k1 = (uint32_t)(seed >> 32);
+
+    float *channel_scales = NULL;
+    if (config->distribution == RANDOM_ACTIVATION) {
+        channel_scales = _gen_channel_scales(config, k0, k1);
+        if (!channel_scales) return 1;
+    }
+
+    /* element e lives in lane e % 4 of philox group e / 4 */
+    const uint64_t first_group = offset / 4;
+    const uint64_t end_group   = (offset + num_elements + 3) / 4;
+    const uint64_t num_batches = (end_group - first_group + RANDOM_BATCH_GROUPS - 1) / RANDOM_BATCH_GROUPS;
+    int failed = 0;
+
+#pragma omp parallel reduction(|:failed)
+    {
+        uint32_t *bits = malloc(RANDOM_BATCH_GROUPS * 4 * sizeof(uint32_t));
+        float *samples = malloc(RANDOM_BATCH_GROUPS * 4 * sizeof(float));
+        if (!bits || !samples) failed = 1;
+
+#pragma omp for schedule(static)
+        for (uint64_t batch = 0; batch < num_batches; ++batch) {
+            if (!bits || !samples) continue;
+
+            const uint64_t g0 = first_group + batch * RANDOM_BATCH_GROUPS;
+            const uint64_t g1 = (g0 + RANDOM_BATCH_GROUPS < end_group) ? g0 + RANDOM_BATCH_GROUPS : end_group;
+
+#pragma omp simd
+            for (uint64_t g = g0; g < g1; ++g) {
+                _philox4x32_10((uint32_t)g, (uint32_t)(g >> 32), 0u, k0, k1, &bits[(g - g0) * 4]);
+            }
+            _transform_batch(bits, samples, g1 - g0, config);
+
+            /* clip the batch to the requested element range */
+            const uint64_t e0 = (g0 * 4 > offset) ? g0 * 4 : offset;
+            const uint64_t e1 = (g1 * 4 < offset + num_elements) ? g1 * 4 : offset + num_elements;
+            for (uint64_t e = e0; e < e1; ++e) {
+                float v = samples[e - g0 * 4];
+                if (channel_scales) v *= channel_scales[e % config->num_features];
+                float_array[e - offset] = v;
+            }
+        }
+
+        free(bits);
+        free(samples);
+    }
+
+    free(channel_scales);
+    return failed;
+}
+
+float *gen_random_float_buffer(uint64_t num_elements,
+                               const random_config_t *config,
+                               uint64_t seed) {
+    if (!num_elements || !config) return NULL;
+
+    float *buffer = malloc(num_elements * sizeof(float));
+    if (!buffer) return NULL;
+
+    if (fill_random_float_array(buffer, num_elements, config, seed, 0)) {
+        free(buffer);
+        return NULL;
+    }
+    return buffer;
+}
+
 float **gen_random_float_arrays(uint64_t count,
                                 uint64_t N,
                                 float minv,
@@ -9,28 +191,28 @@ float **gen_random_float_arrays(uint64_t count,
         return NULL;
 
     if (!seed) seed = (unsigned int)time(NULL);
-    srand(seed);
 
     float **arrs = calloc(count, sizeof(*arrs));
     if (!arrs) return NULL;
 
-    for (uint64_t i = 0; i < count; ++i) {
-        arrs[i] = malloc(N * sizeof(float));
-        if (!arrs[i]) {
-            for (uint64_t j = 0; j < i; ++j) free(arrs[j]);
-            free(arrs);
-            return NULL;
-        }
-        for (uint64_t j = 0; j < N; ++j) {
-            float u = (float)rand() / (float)RAND_MAX;
-            arrs[i][j] = minv + u * (maxv - minv);
-        }
+    const random_config_t config = {
+        .distribution = RANDOM_UNIFORM,
+        .minv = minv,
+        .maxv = maxv,
+    };
+    arrs[0] = gen_random_float_buffer(count * N, &config, seed);
+    if (!arrs[0]) {
+        free(arrs);
+        return NULL;
     }
+
+    for (uint64_t i = 1; i < count; ++i) arrs[i] = arrs[0] + i * N;
     return arrs;
 }
 
 void free_random_float_arrays(float **arrs, uint64_t count) {
     if (!arrs) return;
-    for (uint64_t i = 0; i < count; ++i) free(arrs[i]);
+    (void)count; /* all arrays share the buffer owned by arrs[0] */
+    free(arrs[0]);
     free(arrs);
 }
@@ -0,0 +1,65 @@
+#include "rotation.h"
+
+#define HADAMARD_PARALLEL_MIN_ELEMENTS 16384    /* below this the transform runs on the calling thread */
+
+/* Unnormalized butterflies of one power-of-two block, then a single scaling pass. */
+static void _hadamard_block(float *restrict x, uint64_t n, float norm) {
+    for (uint64_t h = 1; h < n; h *= 2) {
+        for (uint64_t i = 0; i < n; i += 2 * h) {
+            float *restrict lo = x + i;
+            float *restrict hi = x + i + h;
+#pragma omp simd
+            for (uint64_t j = 0; j < h; ++j) {
+                const float a = lo[j];
+                const float b = hi[j];
+                lo[j] = a + b;
+                hi[j] = a - b;
+            }
+        }
+    }
+#pragma omp simd
+    for (uint64_t i = 0; i < n; ++i) {
+        x[i] *= norm;
+    }
+}
+
+static int _check_hadamard_args(const float *data, uint64_t num_elements, uint64_t block_size) {
+    if (!data || !num_elements || !block_size) return 1;
+    if (block_size & (block_size - 1)) return 1;    /* not a power of two */
+    return (num_elements % block_size) ? 1 : 0;
+}
+
+int hadamard_transform(float *data,
+                       uint64_t num_elements,
+                       uint64_t block_size) {
+    if (_check_hadamard_args(data, num_elements, block_size)) return 1;
+    if (block_size == 1) return 0;
+
+    const uint64_t num_blocks = num_elements / block_size;
+    const float norm = 1.0f / sqrtf((float)block_size);
+
+#pragma omp parallel for if(num_elements >= HADAMARD_PARALLEL_MIN_ELEMENTS && num_blocks > 1) schedule(static)
+    for (uint64_t b = 0; b < num_blocks; ++b) {
+        _hadamard_block(data + b * block_size, block_size, norm);
+    }
+    return 0;
+}
+
+int hadamard_transform_local(float *data,
+                             uint64_t num_elements,
+                             uint64_t block_size) {
+    if (_check_hadamard_args(data, num_elements, block_size)) return 1;
+    if (block_size == 1) return 0;
+
+    const float norm = 1.0f / sqrtf((float)block_size);
+    for (uint64_t start = 0; start < num_elements; start += block_size) {
+        _hadamard_block(data + start, block_size, norm);
+    }
+    return 0;
+}
+
+uint64_t hadamard_block_size(uint64_t num_features) {
+    if (!num_features) return 0;
+    uint64_t block_size = num_features & (~num_features + 1);   /* lowest set bit */
+    return (block_size > HADAMARD_MAX_BLOCK_SIZE) ? HADAMARD_MAX_BLOCK_SIZE : block_size;
+}
@@ -1,9 +1,9 @@
 #include "sparsity.h"
+#include "profiling.h"
+#include "autotune.h"
+#include "numa_placement.h"
 
-sparse_array_t *allocate_sparse_array(uint16_t num_tokens, uint16_t num_features, float sparse_ratio) {
-    if (!num_tokens || !num_features) return NULL;
-    if (sparse_ratio < 0.0f || sparse_ratio > 1.0f) return NULL;
-    
+uint16_t get_num_sparse_features(uint16_t num_features, float sparse_ratio) {
     float raw_sparse = (float)num_features * sparse_ratio;
     uint16_t num_sparse_features = (uint16_t)roundf(raw_sparse);
     
@@ -13,19 +13,59 @@ sparse_array_t *allocate_sparse_array(uint16_t num_tokens, uint16_t num_features
     } else if (num_sparse_features == 0 && sparse_ratio > 0.0f) {
         num_sparse_features = 1;  // Avoid total sparsity if ratio positive;
     }
+    return num_sparse_features;
+}
+
+/* Threads, top-k kernel and tokens per scheduling step of a compress run; first touch must use the same. */
+static void _get_compress_config(uint16_t num_tokens, uint16_t num_features, uint16_t num_sparse_features,
+                                 autotune_config_t *config) {
+    /* defaults: the top-k sort on every thread, tokens split evenly; a tuned profile may override */
+    config->num_threads = (uint32_t)omp_get_max_threads();
+    config->chunk       = (num_tokens + config->num_threads - 1) / config->num_threads;
+    config->kernel      = AUTOTUNE_TOPK_SORT;
+    autotune_apply(AUTOTUNE_OP_COMPRESS, 0, (uint64_t)num_tokens * num_features, num_features, num_sparse_features, config);
+}
+
+/* Zeroes every token's indices and values from the thread compress will assign the token to. */
+static void _first_touch_sparse_array(sparse_array_t *sparse_array) {
+    autotune_config_t config;
+    _get_compress_config(sparse_array->num_tokens, sparse_array->num_features, sparse_array->num_sparse_features, &config);
+    const uint16_t k = sparse_array->num_sparse_features;
+
+#pragma omp parallel num_threads(config.num_threads) if(config.num_threads > 1)
+    {
+        numa_bind_worker((uint32_t)omp_get_thread_num(), (uint32_t)omp_get_num_threads());
+
+#pragma omp for schedule(static, config.chunk)
+        for (uint16_t cur_token_index = 0; cur_token_index < sparse_array->num_tokens; cur_token_index++) {
+            memset(sparse_array->sparse_indices + (uint32_t)cur_token_index * k, 0, k * sizeof(uint16_t));
+            memset(sparse_array->values + (uint32_t)cur_token_index * k, 0, k * sizeof(float));
+        }
+        numa_release_worker((uint32_t)omp_get_thread_num());
+    }
+}
+
+sparse_array_t *allocate_sparse_array(uint16_t num_tokens, uint16_t num_features, float sparse_ratio) {
+    if (!num_tokens || !num_features) return NULL;
+    if (sparse_ratio < 0.0f || sparse_ratio > 1.0f) return NULL;
+    
+    uint16_t num_sparse_features = get_num_sparse_features(num_features, sparse_ratio);
 
     uint32_t sparse_elements = (uint32_t)num_tokens * num_sparse_features;
     uint64_t total = sizeof(sparse_array_t) + sparse_elements * (sizeof(float) + sizeof(uint16_t));
-    sparse_array_t *sparse_array = (sparse_array_t*)calloc(1, total);
+    const int first_touch = (numa_get_options() & NUMA_FIRST_TOUCH) != 0;
+    sparse_array_t *sparse_array = (sparse_array_t*)(first_touch ? malloc(total) : calloc(1, total));
     if (!sparse_array) return NULL;
 
     /* initialise the header fields */
+    memset(sparse_array, 0, sizeof(sparse_array_t));
     sparse_array->num_tokens = num_tokens;
     sparse_array->num_features = num_features;
     sparse_array->num_sparse_features = num_sparse_features;
     sparse_array->sparse_indices = (uint16_t*)(sparse_array + 1);    /* just after the header */
     sparse_array->values = (float*)(sparse_array->sparse_indices + sparse_elements);     /* after the sparse_indices */
 
+    if (first_touch) _first_touch_sparse_array(sparse_array);
     return sparse_array;
 }                          
 
@@ -56,6 +96,21 @@ sparse_array_t *load_sparse_array_from_buffer(const void *buffer, uint64_t buffe
     return sparse_array;
 }
 
+int view_sparse_array_from_buffer(const void *buffer, uint64_t buffer_size, sparse_array_t *view) {
+    if (!buffer || !view || buffer_size < sizeof(sparse_array_t)) return 1;
+
+    sparse_array_t header;
+    memcpy(&header, buffer, sizeof(sparse_array_t));
+    if (header.num_sparse_features > header.num_features) return 1;
+    if (get_sparse_array_size(&header) > buffer_size) return 1;
+
+    uint32_t sparse_elements = (uint32_t)header.num_tokens * header.num_sparse_features;
+    header.sparse_indices = (uint16_t*)((uint8_t*)buffer + sizeof(sparse_array_t));
+    header.values         = (float*)(header.sparse_indices + sparse_elements);
+    *view = header;
+    return 0;
+}
+
 typedef struct {
     uint16_t index;
     float abs_val;
@@ -72,53 +127,223 @@ static int abs_sort_cmp(const void *a, const void *b) {
     return (int)idx_a - (int)idx_b;
 }
 
-int compress(const float *float_array, uint16_t num_tokens, uint16_t num_features, float sparse_ratio, sparse_array_t **sparse_array) {
-    if (!float_array || num_tokens == 0 || num_features == 0 || *sparse_array) return 1;
+/* The order of abs_sort_cmp: larger magnitude first, lower index on ties. */
+static inline int _entry_before(const sort_entry_t *a, const sort_entry_t *b) {
+    return a->abs_val > b->abs_val || (a->abs_val == b->abs_val && a->index < b->index);
+}
 
-    /* ---- allocate sparse ------------------------------------------ */
-    *sparse_array = allocate_sparse_array(num_tokens, num_features, sparse_ratio);
-    if (!*sparse_array) return 1;
+static inline void _swap_entries(sort_entry_t *a, sort_entry_t *b) {
+    const sort_entry_t tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
 
-#pragma omp parallel for
-    for (uint16_t cur_token_index = 0; cur_token_index < num_tokens; cur_token_index++) {
-        sort_entry_t *entries = (sort_entry_t *)malloc(num_features * sizeof(sort_entry_t));
-        
-        uint32_t dense_base = (uint32_t)cur_token_index * num_features;
-        uint32_t sparse_base = (uint32_t)cur_token_index * (*sparse_array)->num_sparse_features;
+/*
+ * Quickselect: reorders entries so that entries[0, k) are the first k of the abs_sort_cmp order
+ * (in no particular order). The order is total, so sorting entries[0, k) afterwards gives exactly
+ * the prefix a full qsort would.
+ */
+static void _select_top_entries(sort_entry_t *entries, uint32_t n, uint32_t k) {
+    uint32_t lo = 0, hi = n;
+    while (lo < k && k < hi) {
+        /* median of three as the pivot, parked at hi - 1 */
+        const uint32_t mid = lo + (hi - lo) / 2;
+        if (_entry_before(&entries[mid], &entries[lo]))    _swap_entries(&entries[mid], &entries[lo]);
+        if (_entry_before(&entries[hi - 1], &entries[lo])) _swap_entries(&entries[hi - 1], &entries[lo]);
+        if (_entry_before(&entries[mid], &entries[hi - 1])) _swap_entries(&entries[mid], &entries[hi - 1]);
 
-        for (uint16_t i = 0; i < num_features; i++) {
-            entries[i].index = i;
-            entries[i].abs_val = fabsf(float_array[dense_base + i]);
+        const sort_entry_t pivot = entries[hi - 1];
+        uint32_t store = lo;
+        for (uint32_t i = lo; i < hi - 1; i++) {
+            if (_entry_before(&entries[i], &pivot)) _swap_entries(&entries[i], &entries[store++]);
         }
+        _swap_entries(&entries[store], &entries[hi - 1]);
+
+        if (store < k) lo = store + 1;
+        else           hi = store;
+    }
+}
+
+/* Fills entries with one token's magnitudes and moves its num_sparse_features largest to the front, sorted. */
+static void _rank_token(const float *row, uint16_t num_features, uint16_t num_sparse_features,
+                        uint8_t kernel, sort_entry_t *entries) {
+    for (uint16_t i = 0; i < num_features; i++) {
+        entries[i].index = i;
+        entries[i].abs_val = fabsf(row[i]);
+    }
+    if (kernel == AUTOTUNE_TOPK_SELECT) {
+        _select_top_entries(entries, num_features, num_sparse_features);
+        qsort(entries, num_sparse_features, sizeof(sort_entry_t), abs_sort_cmp);
+    } else {
         qsort(entries, num_features, sizeof(sort_entry_t), abs_sort_cmp);
-        
-        for (uint16_t keep_feature_index = 0; keep_feature_index < (*sparse_array)->num_sparse_features; keep_feature_index++) {
-            uint16_t orig_index = entries[keep_feature_index].index;
-            (*sparse_array)->sparse_indices[sparse_base + keep_feature_index] = orig_index;
-            (*sparse_array)->values[sparse_base + keep_feature_index] = float_array[dense_base + orig_index];
+    }
+}
+
+int compress(const float *float_array, uint16_t num_tokens, uint16_t num_features, float sparse_ratio, sparse_array_t **sparse_array) {
+    return compress_with_metrics(float_array, num_tokens, num_features, sparse_ratio, sparse_array, NULL);
+}
+
+/* Fills an allocated sparse array from float_array, shaped by the array itself. */
+static int _compress_into(const float *float_array, sparse_array_t *out, codec_metrics_t *metrics) {
+    const uint16_t num_tokens = out->num_tokens;
+    const uint16_t num_features = out->num_features;
+    const uint16_t num_sparse_features = out->num_sparse_features;
+
+    autotune_config_t config;
+    _get_compress_config(num_tokens, num_features, num_sparse_features, &config);
+
+    double sum_abs = 0.0, sum_sq = 0.0, sum_signal = 0.0, max_abs = 0.0;
+    int failed = 0;
+
+#pragma omp parallel num_threads(config.num_threads) if(config.num_threads > 1) \
+        reduction(+:sum_abs, sum_sq, sum_signal) reduction(max:max_abs) reduction(|:failed)
+    {
+        numa_bind_worker((uint32_t)omp_get_thread_num(), (uint32_t)omp_get_num_threads());
+
+        /* one scratch row per thread, reused for all its tokens */
+        sort_entry_t *entries = (sort_entry_t *)malloc(num_features * sizeof(sort_entry_t));
+        failed = !entries;
+
+#pragma omp for schedule(static, config.chunk)
+        for (uint16_t cur_token_index = 0; cur_token_index < num_tokens; cur_token_index++) {
+            if (!entries) continue;
+
+            uint32_t dense_base = (uint32_t)cur_token_index * num_features;
+            uint32_t sparse_base = (uint32_t)cur_token_index * num_sparse_features;
+
+            _rank_token(float_array + dense_base, num_features, num_sparse_features, config.kernel, entries);
+
+            for (uint16_t keep_feature_index = 0; keep_feature_index < num_sparse_features; keep_feature_index++) {
+                uint16_t orig_index = entries[keep_feature_index].index;
+                out->sparse_indices[sparse_base + keep_feature_index] = orig_index;
+                out->values[sparse_base + keep_feature_index] = float_array[dense_base + orig_index];
+            }
+
+            /* error statistics: every dropped feature decodes to zero, so its error is its own magnitude */
+            if (metrics) {
+                double token_abs = 0.0, token_sq = 0.0, token_signal = 0.0, token_max = 0.0;
+                for (uint16_t i = num_sparse_features; i < num_features; i++) {
+                    const double ae = entries[i].abs_val;
+                    token_abs += ae;
+                    token_sq  += ae * ae;
+                    if (ae > token_max) token_max = ae;     /* the dropped tail is unordered after a select */
+                }
+#pragma omp simd reduction(+:token_signal)
+                for (uint16_t i = 0; i < num_features; i++) {
+                    const double x = float_array[dense_base + i];
+                    token_signal += x * x;
+                }
+                sum_abs    += token_abs;
+                sum_sq     += token_sq;
+                sum_signal += token_signal;
+                if (token_max > max_abs) max_abs = token_max;
+            }
         }
 
         free(entries);
+        numa_release_worker((uint32_t)omp_get_thread_num());
     }
 
-    return 0;
+    if (!failed && metrics) {
+        codec_metrics_finalize(sum_abs, sum_sq, max_abs, sum_signal, (uint64_t)num_tokens * num_features, metrics);
+    }
+    return failed;
+}
+
+int compress_with_metrics(const float *float_array, uint16_t num_tokens, uint16_t num_features, float sparse_ratio,
+                          sparse_array_t **sparse_array, codec_metrics_t *metrics) {
+    if (!float_array || num_tokens == 0 || num_features == 0 || *sparse_array) return 1;
+
+    /* timed from before the allocation, like quantize, so both report the same span */
+    CODEC_PROFILE_BEGIN(CODEC_OP_COMPRESS, 0, (uint64_t)num_tokens * num_features);
+
+    *sparse_array = allocate_sparse_array(num_tokens, num_features, sparse_ratio);
+    int failed = !*sparse_array || _compress_into(float_array, *sparse_array, metrics);
+    if (failed) {
+        free_sparse_array(*sparse_array);
+        *sparse_array = NULL;
+    }
+
+    CODEC_PROFILE_END(CODEC_OP_COMPRESS, 0, (uint64_t)num_tokens * num_features,
+                      (uint64_t)num_tokens * num_features * sizeof(float),
+                      get_sparse_array_size(*sparse_array));
+    return failed;
+}
+
+int compress_into(const float *float_array, sparse_array_t *sparse_array, codec_metrics_t *metrics) {
+    if (!float_array || !sparse_array || !sparse_array->num_tokens || !sparse_array->num_features) return 1;
+
+    const uint64_t num_elements = (uint64_t)sparse_array->num_tokens * sparse_array->num_features;
+    CODEC_PROFILE_BEGIN(CODEC_OP_COMPRESS, 0, num_elements);
+    int ret = _compress_into(float_array, sparse_array, metrics);
+    CODEC_PROFILE_END(CODEC_OP_COMPRESS, 0, num_elements, num_elements * sizeof(float),
+                      ret ? 0 : get_sparse_array_size(sparse_array));
+    return ret;
+}
+
+/* Scatters one token's retained features into its dense row; the row must already be zeroed. */
+static inline void _scatter_token(const sparse_array_t *sparse_array, uint16_t token_index, float *row) {
+    uint32_t sparse_base = (uint32_t)token_index * sparse_array->num_sparse_features;
+
+    for (uint16_t keep_feature_index = 0; keep_feature_index < sparse_array->num_sparse_features; keep_feature_index++) {
+        uint16_t original_feature_index = sparse_array->sparse_indices[sparse_base + keep_feature_index];
+        row[original_feature_index] = sparse_array->values[sparse_base + keep_feature_index];
+    }
 }
 
 int decompress(const sparse_array_t *sparse_array, float *float_array) {
     if (!float_array || !sparse_array) return 1;
 
     uint32_t num_elements = (uint32_t)sparse_array->num_tokens * sparse_array->num_features;
+    CODEC_PROFILE_BEGIN(CODEC_OP_DECOMPRESS, 0, num_elements);
+
     memset(float_array, 0, num_elements * sizeof(float));
 
     for (uint16_t cur_token_index = 0; cur_token_index < sparse_array->num_tokens; cur_token_index++) {
-        uint32_t dense_base = (uint32_t)cur_token_index * sparse_array->num_features;
-        uint32_t sparse_base = (uint32_t)cur_token_index * sparse_array->num_sparse_features;
+        _scatter_token(sparse_array, cur_token_index, float_array + (uint32_t)cur_token_index * sparse_array->num_features);
+    }
 
-        for (uint16_t keep_feature_index = 0; keep_feature_index < sparse_array->num_sparse_features; keep_feature_index++) {
-            uint16_t original_feature_index = sparse_array->sparse_indices[sparse_base + keep_feature_index];
-            float_array[dense_base + original_feature_index] = sparse_array->values[sparse_base + keep_feature_index];
-        }
+    CODEC_PROFILE_END(CODEC_OP_DECOMPRESS, 0, num_elements,
+                      get_sparse_array_size(sparse_array), (uint64_t)num_elements * sizeof(float));
+    return 0;
+}
+
+int decompress_rows(const sparse_array_t *sparse_array, uint16_t first_token, uint16_t num_tokens, float *float_array) {
+    if (!float_array || !sparse_array || num_tokens == 0) return 1;
+    if ((uint32_t)first_token + num_tokens > sparse_array->num_tokens) return 1;
+
+    uint32_t num_elements = (uint32_t)num_tokens * sparse_array->num_features;
+    CODEC_PROFILE_BEGIN(CODEC_OP_DECOMPRESS, 0, num_elements);
+
+    memset(float_array, 0, num_elements * sizeof(float));
+
+    for (uint16_t i = 0; i < num_tokens; i++) {
+        _scatter_token(sparse_array, (uint16_t)(first_token + i), float_array + (uint32_t)i * sparse_array->num_features);
+    }
+
+    CODEC_PROFILE_END(CODEC_OP_DECOMPRESS, 0, num_elements,
+                      (uint64_t)num_tokens * sparse_array->num_sparse_features * (sizeof(float) + sizeof(uint16_t)),
+                      (uint64_t)num_elements * sizeof(float));
+    return 0;
+}
+
+int decompress_tokens(const sparse_array_t *sparse_array, const uint16_t *token_indices, uint16_t num_selected, float *float_array) {
+    if (!float_array || !sparse_array || !token_indices || num_selected == 0) return 1;
+    for (uint16_t i = 0; i < num_selected; i++) {
+        if (token_indices[i] >= sparse_array->num_tokens) return 1;
+    }
+
+    uint32_t num_elements = (uint32_t)num_selected * sparse_array->num_features;
+    CODEC_PROFILE_BEGIN(CODEC_OP_DECOMPRESS, 0, num_elements);
+
+    memset(float_array, 0, num_elements * sizeof(float));
+
+    for (uint16_t i = 0; i < num_selected; i++) {
+        _scatter_token(sparse_array, token_indices[i], float_array + (uint32_t)i * sparse_array->num_features);
     }
 
+    CODEC_PROFILE_END(CODEC_OP_DECOMPRESS, 0, num_elements,
+                      (uint64_t)num_selected * sparse_array->num_sparse_features * (sizeof(float) + sizeof(uint16_t)),
+                      (uint64_t)num_elements * sizeof(float));
     return 0;
 }
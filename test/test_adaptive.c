@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+
+#include "adaptive.h"
+#include "random.h"
+
+static double measure_mse(const float *orig, const float *deq, uint64_t N) {
+    double s = 0.0;
+    for (uint64_t i = 0; i < N; ++i) {
+        const double e = (double)deq[i] - (double)orig[i];
+        s += e * e;
+    }
+    return s / (double)N;
+}
+
+/* Largest per-block MSE among blocks below q8_0, the fallback the error bound cannot constrain. */
+static double max_block_mse(const mixed_array_t *ma, const float *orig, const float *deq) {
+    double worst = 0.0;
+    for (uint64_t b = 0; b < ma->num_blocks; ++b) {
+        const uint64_t start = b * MIXED_BLOCK_SIZE;
+        const uint64_t n = (start + MIXED_BLOCK_SIZE <= ma->num_elements) ? MIXED_BLOCK_SIZE : ma->num_elements - start;
+        const double mse = measure_mse(orig + start, deq + start, n);
+        if (get_mixed_block_type(ma, b) != MIXED_BLOCK_Q8_0 && mse > worst) worst = mse;
+    }
+    return worst;
+}
+
+/* Serializes header + data the way a file write would, loads it back and decodes both. */
+static int check_round_trip(const mixed_array_t *ma, float *ref, float *out) {
+    const uint64_t size = get_mixed_array_size(ma);
+    uint8_t *buffer = malloc(size);
+    if (!buffer) return 1;
+    memcpy(buffer, ma, sizeof(mixed_array_t));
+    memcpy(buffer + sizeof(mixed_array_t), ma->chunk_offsets, size - sizeof(mixed_array_t));
+
+    mixed_array_t *loaded = load_mixed_array_from_buffer(buffer, size);
+    int failed = !loaded || load_mixed_array_from_buffer(buffer, size - 1) != NULL
+              || mixed_dequantize(ma, ref) || mixed_dequantize(loaded, out)
+              || memcmp(ref, out, ma->num_elements * sizeof(float)) != 0;
+    for (uint64_t b = 0; !failed && b < ma->num_blocks; ++b) {
+        failed = get_mixed_block_type(loaded, b) != get_mixed_block_type(ma, b);
+    }
+    free_mixed_array(loaded);
+    free(buffer);
+    return failed;
+}
+
+int main(void) {
+    /* ---- configuration --------------------------------------------------- */
+    const uint64_t NUM_TOKENS   = 112;
+    const uint64_t NUM_FEATURES = 3584;
+    const uint64_t N            = NUM_TOKENS * NUM_FEATURES;
+    const uint64_t SEED         = 12345;
+    const float BUDGETS[]       = {2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 9.0f};
+    const size_t NUM_BUDGETS    = sizeof(BUDGETS) / sizeof(BUDGETS[0]);
+
+    const random_config_t config = {
+        .distribution = RANDOM_ACTIVATION, .stddev = 1.0f, .num_features = NUM_FEATURES,
+        .outlier_ratio = 0.01f, .outlier_scale = 20.0f,
+    };
+    float *input = gen_random_float_buffer(N, &config, SEED);
+    float *ref   = malloc(N * sizeof(float));
+    float *out   = malloc(N * sizeof(float));
+    if (!input || !ref || !out) {
+        fprintf(stderr, "failed to allocate buffers\n");
+        free(input); free(ref); free(out);
+        return EXIT_FAILURE;
+    }
+
+    /* uneven rows, like a padded batch: every 4th token is padding, every 4th is near silent */
+    for (uint64_t t = 0; t < NUM_TOKENS; ++t) {
+        const float gain = (t % 4 == 0) ? 0.0f : (t % 4 == 1) ? 0.01f : 1.0f;
+        for (uint64_t f = 0; f < NUM_FEATURES; ++f) input[t * NUM_FEATURES + f] *= gain;
+    }
+
+    /* ---- argument checks ------------------------------------------------- */
+    mixed_array_t *ma = NULL;
+    const mixed_config_t bad_config = {.bits_per_element = 0.0f, .max_mse = -1.0f};
+    int failed = mixed_quantize(input, N, &bad_config, &ma, NULL) == 0
+              || mixed_quantize(input, N, NULL, &ma, NULL) == 0;
+    if (failed) fprintf(stderr, "invalid configurations were accepted\n");
+
+    /* ---- uniform q4_0 baseline ------------------------------------------- */
+    quantized_array_t *q4 = NULL;
+    failed = failed || quantize(input, N, QUANTIZED_TYPE_Q4_0, &q4) || dequantize(q4, out);
+    const double q4_bits = failed ? 0.0 : 8.0 * get_quantized_array_size(q4) / (double)N;
+    const double q4_mse  = failed ? 0.0 : measure_mse(input, out, N);
+    free_quantized_array(q4);
+    if (!failed) printf("[uniform q4_0] %.3f bits/element, MSE=%.6f\n", q4_bits, q4_mse);
+
+    /* ---- budget mode: fits, error falls as the budget grows --------------- */
+    double prev_mse = INFINITY, mse_at_q4_bits = INFINITY;
+    for (size_t i = 0; !failed && i < NUM_BUDGETS; ++i) {
+        const mixed_config_t budget = {.bits_per_element = BUDGETS[i], .max_mse = 0.0f};
+        codec_metrics_t metrics;
+        ma = NULL;
+        double t0 = omp_get_wtime();
+        failed = mixed_quantize(input, N, &budget, &ma, &metrics);
+        double t1 = omp_get_wtime();
+        failed = failed || mixed_dequantize(ma, out);
+        double t2 = omp_get_wtime();
+        if (failed) break;
+
+        const double bits = 8.0 * get_mixed_array_size(ma) / (double)N;
+        const double mse  = measure_mse(input, out, N);
+        printf("[mixed %.1f] %.3f bits/element, MSE=%.6f, blocks zero/sparse/q4_0/q8_0 = %lu/%lu/%lu/%lu, "
+               "quantize=%.3f ms, dequantize=%.3f ms\n",
+               BUDGETS[i], bits, mse, ma->block_counts[MIXED_BLOCK_ZERO], ma->block_counts[MIXED_BLOCK_SPARSE],
+               ma->block_counts[MIXED_BLOCK_Q4_0], ma->block_counts[MIXED_BLOCK_Q8_0], (t1 - t0) * 1e3, (t2 - t1) * 1e3);
+
+        failed = bits > BUDGETS[i]
+              || mse > prev_mse * (1.0 + 1e-9)
+              || fabs(metrics.mse - mse) > 1e-6 * (mse + 1e-12)
+              || check_round_trip(ma, ref, out);
+        if (BUDGETS[i] == 5.0f) mse_at_q4_bits = mse;
+        prev_mse = mse;
+        free_mixed_array(ma);
+    }
+    if (failed) fprintf(stderr, "budget mode exceeded its budget or lost accuracy\n");
+
+    /* the same link budget must buy less error than q4_0 everywhere */
+    failed = failed || q4_bits < 5.0 || !(mse_at_q4_bits < q4_mse);
+    if (failed) fprintf(stderr, "mixed encoding did not beat uniform q4_0 at equal bits\n");
+
+    /* ---- error-bound mode: every block within the bound ------------------- */
+    const float BOUNDS[] = {1e-4f, 1e-3f, 1e-2f};
+    for (size_t i = 0; !failed && i < sizeof(BOUNDS) / sizeof(BOUNDS[0]); ++i) {
+        const mixed_config_t bound = {.bits_per_element = 0.0f, .max_mse = BOUNDS[i]};
+        ma = NULL;
+        failed = mixed_quantize(input, N, &bound, &ma, NULL) || mixed_dequantize(ma, out);
+        if (failed) break;
+
+        const double worst = max_block_mse(ma, input, out);
+        printf("[mixed mse<=%.0e] %.3f bits/element, worst non-q8_0 block MSE=%.6f, blocks zero/sparse/q4_0/q8_0 = %lu/%lu/%lu/%lu\n",
+               BOUNDS[i], 8.0 * get_mixed_array_size(ma) / (double)N, worst,
+               ma->block_counts[MIXED_BLOCK_ZERO], ma->block_counts[MIXED_BLOCK_SPARSE],
+               ma->block_counts[MIXED_BLOCK_Q4_0], ma->block_counts[MIXED_BLOCK_Q8_0]);
+        failed = worst > BOUNDS[i] * (1.0 + 1e-5);
+        free_mixed_array(ma);
+    }
+    if (failed) fprintf(stderr, "error-bound mode exceeded its bound\n");
+
+    /* ---- short tails: partial last blocks, including ones shorter than k --- */
+    const uint64_t TAILS[] = {3, 37, 1000 * MIXED_BLOCK_SIZE + 17};
+    for (size_t i = 0; !failed && i < sizeof(TAILS) / sizeof(TAILS[0]); ++i) {
+        const mixed_config_t budget = {.bits_per_element = 6.0f, .max_mse = 0.0f};
+        codec_metrics_t metrics;
+        ma = NULL;
+        failed = mixed_quantize(input + 2 * NUM_FEATURES, TAILS[i], &budget, &ma, &metrics)
+              || check_round_trip(ma, ref, out)
+              || fabs(metrics.mse - measure_mse(input + 2 * NUM_FEATURES, out, TAILS[i])) > 1e-6 * (metrics.mse + 1e-12);
+        free_mixed_array(ma);
+    }
+    if (failed) fprintf(stderr, "partial blocks failed to round trip\n");
+
+    free(input); free(ref); free(out);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+
+#include "autotune.h"
+#include "quantization.h"
+#include "sparsity.h"
+#include "random.h"
+
+#define PROFILE_PATH "test_autotune.profile"
+
+static int same_sparse(const sparse_array_t *a, const sparse_array_t *b) {
+    const uint64_t size = get_sparse_array_size(a);
+    return size == get_sparse_array_size(b)
+        && memcmp(a->sparse_indices, b->sparse_indices, size - sizeof(sparse_array_t)) == 0;
+}
+
+static int same_quantized(const quantized_array_t *a, const quantized_array_t *b) {
+    const uint64_t size = (uint64_t)get_quantized_array_size(a);
+    return size == (uint64_t)get_quantized_array_size(b)
+        && memcmp(a->scales, b->scales, size - sizeof(quantized_array_t)) == 0;
+}
+
+static int same_config(const autotune_config_t *a, const autotune_config_t *b) {
+    return a->num_threads == b->num_threads && a->chunk == b->chunk && a->kernel == b->kernel;
+}
+
+/* A one-entry profile forcing the given compress kernel for every compress call. */
+static void force_compress_kernel(autotune_profile_t *profile, uint8_t kernel) {
+    memset(profile, 0, sizeof(*profile));
+    autotune_register_compress(profile, 1, 1, 1.0f);
+    profile->entries[0].tuned  = 1;
+    profile->entries[0].config = (autotune_config_t){(uint32_t)omp_get_max_threads(), 2, kernel};
+    autotune_set_profile(profile);
+}
+
+/* Select-then-sort must keep exactly the features the full sort keeps, in the same order. */
+static int check_topk_kernels(const float *input, uint16_t num_tokens, uint16_t num_features) {
+    const float ratios[] = {0.0f, 0.001f, 0.1f, 0.5f, 1.0f};
+    autotune_profile_t profile;
+    int failed = 0;
+    for (size_t r = 0; !failed && r < sizeof(ratios) / sizeof(ratios[0]); ++r) {
+        sparse_array_t *sorted = NULL, *selected = NULL;
+        codec_metrics_t m_sorted, m_selected;
+        force_compress_kernel(&profile, AUTOTUNE_TOPK_SORT);
+        failed = compress_with_metrics(input, num_tokens, num_features, ratios[r], &sorted, &m_sorted);
+        force_compress_kernel(&profile, AUTOTUNE_TOPK_SELECT);
+        failed = failed || compress_with_metrics(input, num_tokens, num_features, ratios[r], &selected, &m_selected)
+              || !same_sparse(sorted, selected)
+              || fabs(m_sorted.mse - m_selected.mse) > 1e-9 * (m_sorted.mse + 1e-12)
+              || m_sorted.max_abs != m_selected.max_abs;
+        free_sparse_array(sorted);
+        free_sparse_array(selected);
+    }
+    autotune_set_profile(NULL);
+    return failed;
+}
+
+int main(void) {
+    /* ---- configuration --------------------------------------------------- */
+    const uint16_t NUM_TOKENS   = 112;
+    const uint16_t NUM_FEATURES = 3584;
+    const uint64_t N            = (uint64_t)NUM_TOKENS * NUM_FEATURES;
+    const float    SPARSE_RATIO = 0.10f;
+    const uint32_t REPETITIONS  = 3;
+    const uint64_t SEED         = 12345;
+
+    const random_config_t config = {
+        .distribution = RANDOM_ACTIVATION, .stddev = 1.0f, .num_features = NUM_FEATURES,
+        .outlier_ratio = 0.01f, .outlier_scale = 20.0f,
+    };
+    float *input = gen_random_float_buffer(N, &config, SEED);
+    float *ties  = malloc(N * sizeof(float));
+    if (!input || !ties) {
+        fprintf(stderr, "failed to allocate buffers\n");
+        free(input); free(ties);
+        return EXIT_FAILURE;
+    }
+    /* coarse values give many equal magnitudes, where only the index breaks the tie */
+    for (uint64_t i = 0; i < N; ++i) ties[i] = roundf(input[i] * 2.0f);
+
+    /* ---- top-k kernels agree ---------------------------------------------- */
+    int failed = check_topk_kernels(input, NUM_TOKENS, NUM_FEATURES) || check_topk_kernels(ties, NUM_TOKENS, NUM_FEATURES)
+              || check_topk_kernels(ties, 1, 7);
+    if (failed) fprintf(stderr, "select and sort top-k kernels disagree\n");
+
+    /* ---- untuned reference outputs ---------------------------------------- */
+    quantized_array_t *q_ref = NULL;
+    sparse_array_t *s_ref = NULL;
+    double t0 = omp_get_wtime();
+    for (int r = 0; !failed && r < 100; ++r) {
+        sparse_array_t *token = NULL;
+        failed = compress(input, 1, NUM_FEATURES, SPARSE_RATIO, &token);
+        free_sparse_array(token);
+    }
+    double untuned_token_us = (omp_get_wtime() - t0) * 1e4;
+    failed = failed || quantize(input, N, QUANTIZED_TYPE_Q4_0, &q_ref)
+          || compress(input, NUM_TOKENS, NUM_FEATURES, SPARSE_RATIO, &s_ref);
+
+    /* ---- tune the decode and prefill shapes -------------------------------- */
+    autotune_profile_t profile, loaded;
+    memset(&profile, 0, sizeof(profile));
+    failed = failed
+          || autotune_register_quantize(&profile, QUANTIZED_TYPE_Q4_0, NUM_FEATURES)
+          || autotune_register_quantize(&profile, QUANTIZED_TYPE_Q4_0, N)
+          || autotune_register_compress(&profile, 1, NUM_FEATURES, SPARSE_RATIO)
+          || autotune_register_compress(&profile, NUM_TOKENS, NUM_FEATURES, SPARSE_RATIO)
+          || autotune_register_compress(&profile, 1, NUM_FEATURES, SPARSE_RATIO)      /* already registered */
+          || profile.num_entries != 4
+          || autotune_register_quantize(&profile, QUANTIZED_TYPE_COUNT, N) == 0;
+    t0 = omp_get_wtime();
+    failed = failed || autotune_run(&profile, REPETITIONS);
+    double t1 = omp_get_wtime();
+
+    const char *op_names[] = {"quantize", "compress"};
+    for (uint64_t i = 0; !failed && i < profile.num_entries; ++i) {
+        const autotune_entry_t *e = &profile.entries[i];
+        printf("[autotune] %s n=%lu: threads=%u, chunk=%u, kernel=%u, %.1f us\n", op_names[e->op], e->num_elements,
+               e->config.num_threads, e->config.chunk, e->config.kernel, e->time_us);
+        failed = !e->tuned || e->config.num_threads < 1 || e->config.num_threads > (uint32_t)omp_get_max_threads();
+    }
+    if (!failed) printf("   tuning took %.3f ms\n", (t1 - t0) * 1e3);
+
+    /* ---- profile file round trip -------------------------------------------- */
+    failed = failed || autotune_save_profile(&profile, PROFILE_PATH) || autotune_load_profile(&loaded, PROFILE_PATH)
+          || loaded.num_entries != profile.num_entries;
+    for (uint64_t i = 0; !failed && i < profile.num_entries; ++i) {
+        const autotune_entry_t *a = &profile.entries[i], *b = &loaded.entries[i];
+        failed = a->op != b->op || a->format != b->format || a->num_elements != b->num_elements
+              || a->num_features != b->num_features || a->num_kept != b->num_kept || !b->tuned
+              || !same_config(&a->config, &b->config);
+    }
+    if (failed) fprintf(stderr, "tuning or the profile round trip failed\n");
+
+    /* ---- tuned calls: same output, nearest shape for unregistered sizes ---- */
+    autotune_set_profile(&loaded);
+    quantized_array_t *q_tuned = NULL;
+    sparse_array_t *s_tuned = NULL;
+    failed = failed || quantize(input, N, QUANTIZED_TYPE_Q4_0, &q_tuned) || !same_quantized(q_ref, q_tuned)
+          || compress(input, NUM_TOKENS, NUM_FEATURES, SPARSE_RATIO, &s_tuned) || !same_sparse(s_ref, s_tuned);
+
+    autotune_config_t applied = {0, 0, 0};
+    autotune_apply(AUTOTUNE_OP_COMPRESS, 0, 2 * (uint64_t)NUM_FEATURES, NUM_FEATURES,
+                   get_num_sparse_features(NUM_FEATURES, SPARSE_RATIO), &applied);
+    failed = failed || !same_config(&applied, &loaded.entries[2].config);
+
+    t0 = omp_get_wtime();
+    for (int r = 0; !failed && r < 100; ++r) {
+        sparse_array_t *token = NULL;
+        failed = compress(input, 1, NUM_FEATURES, SPARSE_RATIO, &token);
+        free_sparse_array(token);
+    }
+    double tuned_token_us = (omp_get_wtime() - t0) * 1e4;
+    autotune_set_profile(NULL);
+    if (!failed) printf("   1x%u compress: untuned %.1f us, tuned %.1f us\n", NUM_FEATURES, untuned_token_us, tuned_token_us);
+    if (failed) fprintf(stderr, "tuned calls changed the output or picked the wrong shape\n");
+
+    /* ---- malformed profiles are rejected ------------------------------------ */
+    FILE *file = failed ? NULL : fopen(PROFILE_PATH, "w");
+    if (file) {
+        fprintf(file, "compress 0 1000 3584 358 1 1 0 1.0\n");      /* 1000 is not a whole number of rows */
+        fclose(file);
+        failed = autotune_load_profile(&loaded, PROFILE_PATH) == 0;
+        if (failed) fprintf(stderr, "a malformed profile was accepted\n");
+    }
+
+    remove(PROFILE_PATH);
+    free_quantized_array(q_ref); free_quantized_array(q_tuned);
+    free_sparse_array(s_ref); free_sparse_array(s_tuned);
+    free(input); free(ties);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <omp.h>
+
+#include "container.h"
+#include "random.h"
+
+#define CONTAINER_PATH  "test_container.qsp"
+#define DAMAGED_PATH    "test_container_damaged.qsp"
+#define FULL_DEVICE_PATH "/dev/full"       /* every write fails with ENOSPC */
+
+/* Copies the first length bytes of CONTAINER_PATH to DAMAGED_PATH, optionally zeroing the index offset. */
+static int write_damaged_copy(uint64_t length, int clear_index_offset) {
+    FILE *in = fopen(CONTAINER_PATH, "rb");
+    FILE *out = fopen(DAMAGED_PATH, "wb");
+    uint8_t *bytes = malloc(length);
+    int failed = !in || !out || !bytes || fread(bytes, 1, length, in) != length;
+    if (!failed && clear_index_offset) memset(bytes + offsetof(container_header_t, index_offset), 0, sizeof(uint64_t));
+    failed = failed || fwrite(bytes, 1, length, out) != length;
+    free(bytes);
+    if (in) fclose(in);
+    if (out) fclose(out);
+    return failed;
+}
+
+int main(void) {
+    /* ---- configuration --------------------------------------------------- */
+    const uint16_t NUM_TOKENS    = 112;
+    const uint16_t NUM_FEATURES  = 3584;
+    const uint64_t N             = (uint64_t)NUM_TOKENS * NUM_FEATURES;
+    const uint64_t TRACE_STEPS   = 300;         /* single-token tensors, like a decode trace */
+    const uint64_t SEED          = 12345;
+
+    const random_config_t config = {
+        .distribution = RANDOM_ACTIVATION, .stddev = 1.0f, .num_features = NUM_FEATURES,
+        .outlier_ratio = 0.01f, .outlier_scale = 20.0f,
+    };
+    float *input = gen_random_float_buffer(N, &config, SEED);
+    float *ref   = malloc(N * sizeof(float));
+    float *out   = malloc(N * sizeof(float));
+    quantized_array_t *q8 = NULL, *q4r = NULL;
+    sparse_array_t *sa = NULL;
+    if (!input || !ref || !out ||
+        quantize(input, N, QUANTIZED_TYPE_Q8_0, &q8) ||
+        quantize_rotated(input, N, NUM_FEATURES, QUANTIZED_TYPE_Q4_1, &q4r) ||
+        compress(input, NUM_TOKENS, NUM_FEATURES, 0.10f, &sa)) {
+        fprintf(stderr, "failed to prepare the tensors\n");
+        free(input); free(ref); free(out);
+        free_quantized_array(q8); free_quantized_array(q4r); free_sparse_array(sa);
+        return EXIT_FAILURE;
+    }
+
+    /* ---- write: three large tensors, then a stream of single tokens ------- */
+    const uint64_t shape[2] = {NUM_TOKENS, NUM_FEATURES};
+    double t0 = omp_get_wtime();
+    container_writer_t *writer = create_container(CONTAINER_PATH);
+    int failed = !writer
+              || append_quantized_to_container(writer, "act.q8_0", shape, 2, q8)
+              || append_quantized_to_container(writer, "act.q4_1.rotated", shape, 2, q4r)
+              || append_sparse_to_container(writer, "act.sparse", sa);
+    char name[CONTAINER_MAX_NAME];
+    for (uint64_t t = 0; !failed && t < TRACE_STEPS; ++t) {
+        quantized_array_t *token = NULL;
+        snprintf(name, sizeof(name), "trace.%04lu", t);
+        failed = quantize(input + (t % NUM_TOKENS) * NUM_FEATURES, NUM_FEATURES, QUANTIZED_TYPE_Q4_0, &token)
+              || append_quantized_to_container(writer, name, &shape[1], 1, token);
+        free_quantized_array(token);
+    }
+    /* duplicate names and over-long names are refused without breaking the stream */
+    failed = failed || append_sparse_to_container(writer, "act.sparse", sa) == 0;
+    char long_name[CONTAINER_MAX_NAME + 1];
+    memset(long_name, 'x', CONTAINER_MAX_NAME);
+    long_name[CONTAINER_MAX_NAME] = '\0';
+    failed = failed || append_sparse_to_container(writer, long_name, sa) == 0;
+    if (writer) failed |= finalize_container(writer);
+    double t1 = omp_get_wtime();
+
+    /* ---- read back through the mapping ------------------------------------- */
+    container_reader_t *reader = failed ? NULL : open_container(CONTAINER_PATH);
+    double t2 = omp_get_wtime();
+    failed = failed || !reader || reader->num_tensors != 3 + TRACE_STEPS;
+
+    quantized_array_t qview;
+    sparse_array_t sview;
+    const container_entry_t *entry = failed ? NULL : find_in_container(reader, "act.q8_0");
+    failed = failed || !entry || entry->num_dims != 2 || entry->shape[1] != NUM_FEATURES
+          || entry->offset % CONTAINER_ALIGNMENT
+          || view_quantized_from_container(reader, entry, &qview)
+          || (const uint8_t *)qview.scales < reader->base            /* zero-copy: points into the file */
+          || dequantize(q8, ref) || dequantize(&qview, out) || memcmp(ref, out, N * sizeof(float)) != 0
+          || view_sparse_from_container(reader, entry, &sview) == 0;  /* wrong codec */
+
+    entry = failed ? NULL : find_in_container(reader, "act.q4_1.rotated");
+    failed = failed || !entry || entry->quantized_type != QUANTIZED_TYPE_Q4_1
+          || view_quantized_from_container(reader, entry, &qview) || qview.rotation_size != q4r->rotation_size
+          || dequantize(q4r, ref) || dequantize(&qview, out) || memcmp(ref, out, N * sizeof(float)) != 0;
+
+    entry = failed ? NULL : find_in_container(reader, "act.sparse");
+    failed = failed || !entry || view_sparse_from_container(reader, entry, &sview)
+          || decompress(sa, ref) || decompress(&sview, out) || memcmp(ref, out, N * sizeof(float)) != 0;
+
+    /* every trace step is found by name and decodes to the same token */
+    double t3 = omp_get_wtime();
+    for (uint64_t t = TRACE_STEPS; !failed && t-- > 0;) {
+        snprintf(name, sizeof(name), "trace.%04lu", t);
+        entry = find_in_container(reader, name);
+        failed = !entry || view_quantized_from_container(reader, entry, &qview) || dequantize(&qview, out);
+    }
+    double t4 = omp_get_wtime();
+    if (!failed) {
+        quantized_array_t *token = NULL;
+        failed = quantize(input, NUM_FEATURES, QUANTIZED_TYPE_Q4_0, &token)     /* trace.0000, decoded last */
+              || dequantize(token, ref) || memcmp(ref, out, NUM_FEATURES * sizeof(float)) != 0;
+        free_quantized_array(token);
+    }
+    failed = failed || find_in_container(reader, "missing") != NULL;
+
+    if (!failed) {
+        printf("[container] %lu tensors, file=%.3f KB\n", reader->num_tensors, reader->file_size / 1024.0);
+        printf("   write=%.3f ms, open=%.3f ms, %lu lookups + views=%.3f ms\n",
+               (t1 - t0) * 1e3, (t2 - t1) * 1e3, TRACE_STEPS, (t4 - t3) * 1e3);
+    }
+
+    /* ---- unfinished and truncated files are rejected ------------------------ */
+    const uint64_t file_size = reader ? reader->file_size : 0;
+    close_container(reader);
+    if (!failed) {
+        failed = write_damaged_copy(file_size, 1);
+        container_reader_t *damaged = failed ? NULL : open_container(DAMAGED_PATH);
+        failed = failed || damaged != NULL;
+        close_container(damaged);
+
+        failed = failed || write_damaged_copy(file_size - 100, 0);
+        damaged = failed ? NULL : open_container(DAMAGED_PATH);
+        failed = failed || damaged != NULL;
+        close_container(damaged);
+    }
+    if (failed) fprintf(stderr, "container round trip failed\n");
+
+    /* ---- a failed write poisons the writer ----------------------------------- */
+    /* /dev/full accepts the buffered header but fails the first large payload; the small
+     * append after it would still fit in the stdio buffer, yet must fail like finalize */
+    container_writer_t *full = failed ? NULL : create_container(FULL_DEVICE_PATH);
+    if (full) {
+        quantized_array_t *token = NULL;
+        failed = quantize(input, NUM_FEATURES, QUANTIZED_TYPE_Q4_0, &token)
+              || append_quantized_to_container(full, "act.q8_0", shape, 2, q8) == 0
+              || append_quantized_to_container(full, "trace.0000", &shape[1], 1, token) == 0;
+        failed |= finalize_container(full) == 0;
+        free_quantized_array(token);
+        if (failed) fprintf(stderr, "a failed container write went unreported\n");
+    }
+
+    remove(CONTAINER_PATH);
+    remove(DAMAGED_PATH);
+    free(input); free(ref); free(out);
+    free_quantized_array(q8); free_quantized_array(q4r); free_sparse_array(sa);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
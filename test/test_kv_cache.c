@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <math.h>
+
+#include "kv_cache.h"
+#include "random.h"
+
+int main(void) {
+    /* ---- configuration --------------------------------------------------- */
+    const uint16_t NUM_FEATURES    = 3584;      /* floats per token                  */
+    const uint64_t PREFILL_TOKENS  = 200;       /* appended in one call              */
+    const uint64_t DECODE_TOKENS   = 100;       /* appended one token at a time      */
+    const uint64_t NUM_TOKENS      = PREFILL_TOKENS + DECODE_TOKENS;
+    const uint16_t TOKENS_PER_PAGE = 64;
+    const uint64_t N               = NUM_TOKENS * NUM_FEATURES;
+    const uint64_t SEED            = 12345;
+
+    const random_config_t config = {
+        .distribution = RANDOM_ACTIVATION, .stddev = 1.0f, .num_features = NUM_FEATURES,
+        .outlier_ratio = 0.01f, .outlier_scale = 20.0f,
+    };
+    float *input = gen_random_float_buffer(N, &config, SEED);
+    float *ref   = malloc(N * sizeof(float));
+    float *out   = malloc(N * sizeof(float));
+    if (!input || !ref || !out) {
+        fprintf(stderr, "failed to allocate buffers\n");
+        free(input); free(ref); free(out);
+        return EXIT_FAILURE;
+    }
+
+    const char *names[] = {"q8_0", "q4_0"};
+    for (uint8_t qtype = 0; qtype < 2; ++qtype) {
+        /* ---- reference: quantize the whole tensor row-wise at once -------- */
+        token_quantized_array_t *ta = NULL;
+        if (quantize_tokens(input, (uint16_t)NUM_TOKENS, NUM_FEATURES, qtype, 0, &ta) || dequantize_tokens(ta, ref)) {
+            fprintf(stderr, "%s reference quantization failed\n", names[qtype]);
+            free_token_quantized_array(ta);
+            free(input); free(ref); free(out);
+            return EXIT_FAILURE;
+        }
+
+        /* ---- prefill, then decode token by token -------------------------- */
+        quantized_cache_t *cache = allocate_quantized_cache(NUM_FEATURES, qtype, 0, TOKENS_PER_PAGE);
+        int failed = !cache || append_to_quantized_cache(cache, input, PREFILL_TOKENS);
+        for (uint64_t t = PREFILL_TOKENS; !failed && t < NUM_TOKENS; ++t) {
+            failed = append_to_quantized_cache(cache, input + t * NUM_FEATURES, 1);
+        }
+
+        /* ---- windows: everything, across a page boundary, the last token -- */
+        const uint64_t windows[][2] = {{0, NUM_TOKENS}, {60, 10}, {NUM_TOKENS - 1, 1}, {128, 64}};
+        for (size_t w = 0; !failed && w < sizeof(windows) / sizeof(windows[0]); ++w) {
+            failed = read_from_quantized_cache(cache, windows[w][0], windows[w][1], out)
+                  || memcmp(out, ref + windows[w][0] * NUM_FEATURES, windows[w][1] * NUM_FEATURES * sizeof(float)) != 0;
+        }
+        failed = failed || read_from_quantized_cache(cache, NUM_TOKENS, 1, out) == 0;   /* past the end */
+
+        /* ---- drop the last 10 tokens and append them again ---------------- */
+        failed = failed
+              || truncate_quantized_cache(cache, NUM_TOKENS - 10)
+              || append_to_quantized_cache(cache, input + (NUM_TOKENS - 10) * NUM_FEATURES, 10)
+              || read_from_quantized_cache(cache, 0, NUM_TOKENS, out)
+              || memcmp(out, ref, N * sizeof(float)) != 0;
+
+        if (failed) {
+            fprintf(stderr, "%s cache disagrees with the row-wise reference\n", names[qtype]);
+            free_quantized_cache(cache);
+            free_token_quantized_array(ta);
+            free(input); free(ref); free(out);
+            return EXIT_FAILURE;
+        }
+
+        double size_kb = get_quantized_cache_size(cache) / 1024.0;
+        double bw = 8.0 * size_kb * 1024.0 / (double)N;
+        printf("   %s cache: tokens=%" PRIu64 ", pages=%" PRIu64 ", size=%.3f KB (float %.3f KB), B/W=%.5f\n",
+               names[qtype], cache->num_tokens, cache->num_pages, size_kb, N * sizeof(float) / 1024.0, bw);
+
+        free_quantized_cache(cache);
+        free_token_quantized_array(ta);
+    }
+
+    free(input); free(ref); free(out);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,198 @@
+#define _GNU_SOURCE                     /* sched_getaffinity, CPU_COUNT */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sched.h>
+#include <omp.h>
+
+#include "numa_placement.h"
+#include "quantization.h"
+#include "sparsity.h"
+#include "random.h"
+
+static int check_cpulist_parser(void) {
+    const uint16_t expected[] = {0, 1, 2, 3, 8, 10, 11};
+    uint16_t cpus[16];
+    uint32_t num_cpus = 0;
+    int failed = numa_parse_cpulist("0-3,8,10-11\n", cpus, 16, &num_cpus)
+              || num_cpus != 7 || memcmp(cpus, expected, sizeof(expected)) != 0;
+    failed = failed || numa_parse_cpulist("", cpus, 16, &num_cpus) || num_cpus != 0;
+    failed = failed || numa_parse_cpulist("3-1", cpus, 16, &num_cpus) == 0
+                    || numa_parse_cpulist("0,,2", cpus, 16, &num_cpus) == 0
+                    || numa_parse_cpulist("0-", cpus, 16, &num_cpus) == 0
+                    || numa_parse_cpulist("0-20", cpus, 16, &num_cpus) == 0;   /* more than max_cpus */
+    return failed;
+}
+
+/* Every CPU in exactly one node; workers fill nodes in order. */
+static int check_topology(const numa_topology_t *topology) {
+    int failed = topology->num_nodes < 1 || topology->num_cpus < 1
+              || topology->node_offsets[topology->num_nodes] != topology->num_cpus;
+    for (uint32_t a = 0; !failed && a < topology->num_cpus; ++a) {
+        for (uint32_t b = a + 1; !failed && b < topology->num_cpus; ++b) failed = topology->cpus[a] == topology->cpus[b];
+    }
+    const uint32_t num_threads = 4 * topology->num_nodes;
+    for (uint32_t t = 1; !failed && t < num_threads; ++t) {
+        failed = numa_node_of_worker(t, num_threads) < numa_node_of_worker(t - 1, num_threads);
+    }
+    failed = failed || numa_node_of_worker(0, num_threads) != 0
+                    || numa_node_of_worker(num_threads - 1, num_threads) != topology->num_nodes - 1;
+    return failed;
+}
+
+/* Quantizes every format (and q4_0 rotated, kept at q_ref[QUANTIZED_TYPE_COUNT]) and compresses with the current options, comparing against the reference outputs. */
+static int check_outputs(const float *input, uint64_t n, uint16_t num_tokens, uint16_t num_features,
+                         quantized_array_t **q_ref, sparse_array_t **s_ref) {
+    int failed = 0;
+    for (uint8_t qtype = 0; !failed && qtype < QUANTIZED_TYPE_COUNT; ++qtype) {
+        quantized_array_t *qa = NULL;
+        failed = quantize(input, n, qtype, &qa);
+        if (!failed && !q_ref[qtype]) {
+            q_ref[qtype] = qa;
+            continue;
+        }
+        const uint64_t size = failed ? 0 : (uint64_t)get_quantized_array_size(qa);
+        failed = failed || size != (uint64_t)get_quantized_array_size(q_ref[qtype])
+              || memcmp(qa->scales, q_ref[qtype]->scales, size - sizeof(quantized_array_t)) != 0;
+        free_quantized_array(qa);
+    }
+
+    /* the rotated path binds its tile workers as well */
+    quantized_array_t *qr = NULL;
+    failed = failed || quantize_rotated(input, n - n % num_features, num_features, QUANTIZED_TYPE_Q4_0, &qr);
+    if (!failed && !q_ref[QUANTIZED_TYPE_COUNT]) {
+        q_ref[QUANTIZED_TYPE_COUNT] = qr;
+    } else {
+        const uint64_t size = failed ? 0 : (uint64_t)get_quantized_array_size(qr);
+        failed = failed || size != (uint64_t)get_quantized_array_size(q_ref[QUANTIZED_TYPE_COUNT])
+              || memcmp(qr->scales, q_ref[QUANTIZED_TYPE_COUNT]->scales, size - sizeof(quantized_array_t)) != 0;
+        free_quantized_array(qr);
+    }
+
+    sparse_array_t *sa = NULL;
+    failed = failed || compress(input, num_tokens, num_features, 0.10f, &sa);
+    if (!failed && !*s_ref) {
+        *s_ref = sa;
+        return 0;
+    }
+    const uint64_t size = failed ? 0 : get_sparse_array_size(sa);
+    failed = failed || size != get_sparse_array_size(*s_ref)
+          || memcmp(sa->sparse_indices, (*s_ref)->sparse_indices, size - sizeof(sparse_array_t)) != 0;
+    free_sparse_array(sa);
+    return failed;
+}
+
+/* Inside a codec region the caller is bound like any worker, and released before the call returns. */
+static int check_caller_inside_region(const cpu_set_t *initial) {
+    const uint32_t options = numa_get_options();
+    cpu_set_t inside, after;
+    int failed = 0;
+#pragma omp parallel num_threads(1)
+    {
+        numa_bind_worker(0, 1);
+        failed = sched_getaffinity(0, sizeof(inside), &inside) != 0;
+        numa_release_worker(0);
+    }
+    failed = failed || sched_getaffinity(0, sizeof(after), &after) != 0 || !CPU_EQUAL(&after, initial);
+    if (!failed && (options & NUMA_PIN_THREADS)) failed = CPU_COUNT(&inside) != 1;
+    if (!failed && !(options & (NUMA_PIN_THREADS | NUMA_NODE_POOLS))) failed = !CPU_EQUAL(&inside, initial);
+    return failed;
+}
+
+static quantized_array_t *(*const allocators[QUANTIZED_TYPE_COUNT])(uint64_t, uint64_t) = {
+    allocate_q8_0_array, allocate_q4_0_array, allocate_q4_1_array,
+    allocate_q5_0_array, allocate_q5_1_array, allocate_q8_1_array,
+};
+
+/* Freshly allocated arrays are all zero, also when their memory is recycled dirty heap; generic block sizes too. */
+static int check_zeroed_allocations(uint64_t n) {
+    int failed = 0;
+    for (uint8_t qtype = 0; !failed && qtype < QUANTIZED_TYPE_COUNT; ++qtype) {
+        for (uint64_t block_size = 32; !failed && block_size <= 40; block_size += 8) {
+            quantized_array_t *dirty = allocators[qtype](n, block_size);
+            failed = !dirty;
+            if (failed) break;
+            memset(dirty->scales, 0xFF, (uint64_t)get_quantized_array_size(dirty) - sizeof(quantized_array_t));
+            free_quantized_array(dirty);
+
+            quantized_array_t *qa = allocators[qtype](n, block_size);
+            failed = !qa;
+            const uint8_t *bytes = failed ? NULL : (const uint8_t *)qa->scales;
+            const uint64_t size = failed ? 0 : (uint64_t)get_quantized_array_size(qa) - sizeof(quantized_array_t);
+            for (uint64_t i = 0; !failed && i < size; ++i) failed = bytes[i] != 0;
+            free_quantized_array(qa);
+        }
+    }
+    return failed;
+}
+
+int main(void) {
+    /* ---- configuration --------------------------------------------------- */
+    const uint16_t NUM_TOKENS   = 112;
+    const uint16_t NUM_FEATURES = 3584;
+    const uint64_t N            = (uint64_t)NUM_TOKENS * NUM_FEATURES;
+    const uint64_t ODD_N        = N - 13;          /* partial last block */
+    const uint64_t SEED         = 12345;
+
+    const random_config_t config = {
+        .distribution = RANDOM_ACTIVATION, .stddev = 1.0f, .num_features = NUM_FEATURES,
+        .outlier_ratio = 0.01f, .outlier_scale = 20.0f,
+    };
+    float *input = gen_random_float_buffer(N, &config, SEED);
+    if (!input) {
+        fprintf(stderr, "failed to allocate buffers\n");
+        return EXIT_FAILURE;
+    }
+
+    /* ---- topology ---------------------------------------------------------- */
+    numa_topology_t topology;
+    numa_get_topology(&topology);
+    int failed = check_cpulist_parser() || check_topology(&topology);
+    if (!failed) {
+        printf("[numa] %u node(s), %u cpu(s):", topology.num_nodes, topology.num_cpus);
+        for (uint32_t n = 0; n < topology.num_nodes; ++n)
+            printf(" node%u=%u", topology.node_ids[n], topology.node_offsets[n + 1] - topology.node_offsets[n]);
+        printf("\n");
+    }
+    if (failed) fprintf(stderr, "cpulist parsing or topology checks failed\n");
+
+    cpu_set_t initial;
+    failed = failed || sched_getaffinity(0, sizeof(initial), &initial) != 0;
+
+    /* ---- every option combination gives the default output ------------------ */
+    const uint32_t option_sets[] = {
+        0, NUMA_FIRST_TOUCH, NUMA_PIN_THREADS | NUMA_FIRST_TOUCH, NUMA_NODE_POOLS | NUMA_FIRST_TOUCH, 0,
+    };
+    quantized_array_t *q_ref[QUANTIZED_TYPE_COUNT + 1] = {NULL};
+    quantized_array_t *q_odd[QUANTIZED_TYPE_COUNT + 1] = {NULL};
+    sparse_array_t *s_ref = NULL, *s_odd = NULL;
+    for (size_t o = 0; !failed && o < sizeof(option_sets) / sizeof(option_sets[0]); ++o) {
+        failed = numa_set_options(option_sets[o]) || numa_get_options() != option_sets[o];
+        double t0 = omp_get_wtime();
+        failed = failed || check_outputs(input, N, NUM_TOKENS, NUM_FEATURES, q_ref, &s_ref);
+        double t1 = omp_get_wtime();
+        failed = failed || check_outputs(input, ODD_N, 1, NUM_FEATURES, q_odd, &s_odd)
+              || check_zeroed_allocations(ODD_N);
+
+        /* only the workers stay bound: every codec call hands the caller its own affinity back */
+        cpu_set_t mask;
+        failed = failed || sched_getaffinity(0, sizeof(mask), &mask) != 0 || !CPU_EQUAL(&mask, &initial)
+              || check_caller_inside_region(&initial);
+
+        if (!failed) printf("   options=0x%x: all formats + compress %.3f ms, affinity %d cpu(s)\n",
+                            option_sets[o], (t1 - t0) * 1e3, CPU_COUNT(&mask));
+    }
+    if (failed) fprintf(stderr, "NUMA options changed codec output, left memory dirty or misplaced threads\n");
+
+    numa_set_options(0);
+    for (uint8_t qtype = 0; qtype <= QUANTIZED_TYPE_COUNT; ++qtype) {
+        free_quantized_array(q_ref[qtype]);
+        free_quantized_array(q_odd[qtype]);
+    }
+    free_sparse_array(s_ref);
+    free_sparse_array(s_odd);
+    free(input);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
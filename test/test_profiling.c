@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "profiling.h"
+#include "quantization.h"
+#include "sparsity.h"
+#include "random.h"
+
+static uint64_t begin_calls = 0;
+static uint64_t end_calls = 0;
+
+static void on_begin(codec_op_t op, uint8_t format, uint64_t num_elements, void *user_data) {
+    (void)op; (void)format; (void)num_elements; (void)user_data;
+    begin_calls++;
+}
+
+static void on_end(codec_op_t op, uint8_t format, uint64_t num_elements, void *user_data) {
+    (void)op; (void)format; (void)num_elements; (void)user_data;
+    end_calls++;
+}
+
+static void print_counters(const char *name, const codec_counters_t *c) {
+    if (!c->calls) return;
+    double ratio = c->bytes_out ? (double)c->bytes_in / (double)c->bytes_out : 0.0;
+    double gbps  = c->ns ? (double)c->bytes_in / (double)c->ns : 0.0;   /* bytes per ns == GB/s */
+    printf("   %-18s calls=%lu, elements=%lu, in=%.3f KB, out=%.3f KB, ratio=%.3f, time=%.3f ms, %.3f GB/s\n",
+           name, c->calls, c->elements, c->bytes_in / 1024.0, c->bytes_out / 1024.0,
+           ratio, c->ns / 1e6, gbps);
+}
+
+int main(void) {
+    /* ---- configuration --------------------------------------------------- */
+    const uint64_t X              = 4;              /* number of random arrays            */
+    const uint16_t NUM_TOKENS     = 112;            /* rows in 2D shape                    */
+    const uint16_t NUM_FEATURES   = 3584;           /* columns in 2D shape                 */
+    const uint64_t N              = (uint64_t)NUM_TOKENS * NUM_FEATURES;
+    const unsigned int SEED       = 12345;
+
+    float **inputs = gen_random_float_arrays(X, N, -10.0f, 10.0f, SEED);
+    if (!inputs) {
+        fprintf(stderr, "failed to allocate random inputs\n");
+        return EXIT_FAILURE;
+    }
+
+    float *out = malloc(N * sizeof(float));
+    if (!out) {
+        fprintf(stderr, "malloc failed for output buffer\n");
+        free_random_float_arrays(inputs, X);
+        return EXIT_FAILURE;
+    }
+
+    codec_profile_reset();
+    codec_set_trace_hooks(on_begin, on_end, NULL);
+
+    /* ---- run every codec on every array ---------------------------------- */
+    uint64_t encoded_bytes[CODEC_PROFILE_MAX_FORMATS] = {0};   /* summed output sizes per quantize slot */
+    uint64_t sparse_bytes = 0;
+    for (uint64_t k = 0; k < X; ++k) {
+        for (uint8_t qtype = 0; qtype < 2; ++qtype) {
+            quantized_array_t *qa = NULL;
+            if (quantize(inputs[k], N, qtype, &qa) || dequantize(qa, out)) {
+                fprintf(stderr, "quantization round trip failed (array %lu, type %u)\n", k, qtype);
+                free_quantized_array(qa);
+                free(out);
+                free_random_float_arrays(inputs, X);
+                return EXIT_FAILURE;
+            }
+            encoded_bytes[qtype] += (uint64_t)get_quantized_array_size(qa);
+            free_quantized_array(qa);
+
+            /* per-token arrays of the same formats are counted in their own slots */
+            token_quantized_array_t *ta = NULL;
+            if (quantize_tokens(inputs[k], NUM_TOKENS, NUM_FEATURES, qtype, 32, &ta) || dequantize_tokens(ta, out)) {
+                fprintf(stderr, "per-token round trip failed (array %lu, type %u)\n", k, qtype);
+                free_token_quantized_array(ta);
+                free(out);
+                free_random_float_arrays(inputs, X);
+                return EXIT_FAILURE;
+            }
+            encoded_bytes[TOKEN_PROFILE_FORMAT(qtype)] += get_token_quantized_array_size(ta);
+            free_token_quantized_array(ta);
+        }
+
+        sparse_array_t *sa = NULL;
+        if (compress(inputs[k], NUM_TOKENS, NUM_FEATURES, 0.10f, &sa) || decompress(sa, out)) {
+            fprintf(stderr, "sparsity round trip failed (array %lu)\n", k);
+            free_sparse_array(sa);
+            free(out);
+            free_random_float_arrays(inputs, X);
+            return EXIT_FAILURE;
+        }
+        sparse_bytes += get_sparse_array_size(sa);
+        free_sparse_array(sa);
+    }
+
+    codec_set_trace_hooks(NULL, NULL, NULL);
+
+    /* ---- report ------------------------------------------------------------ */
+    codec_profile_t profile;
+    codec_profile_snapshot(&profile);
+
+    printf("[profile] %lu arrays of N=%lu (tokens=%u, features=%u)\n", X, N, NUM_TOKENS, NUM_FEATURES);
+    print_counters("quantize q8_0",   &profile.counters[CODEC_OP_QUANTIZE][0]);
+    print_counters("dequantize q8_0", &profile.counters[CODEC_OP_DEQUANTIZE][0]);
+    print_counters("quantize q4_0",   &profile.counters[CODEC_OP_QUANTIZE][1]);
+    print_counters("dequantize q4_0", &profile.counters[CODEC_OP_DEQUANTIZE][1]);
+    print_counters("quantize q8_0/t",   &profile.counters[CODEC_OP_QUANTIZE][TOKEN_PROFILE_FORMAT(0)]);
+    print_counters("dequantize q8_0/t", &profile.counters[CODEC_OP_DEQUANTIZE][TOKEN_PROFILE_FORMAT(0)]);
+    print_counters("quantize q4_0/t",   &profile.counters[CODEC_OP_QUANTIZE][TOKEN_PROFILE_FORMAT(1)]);
+    print_counters("dequantize q4_0/t", &profile.counters[CODEC_OP_DEQUANTIZE][TOKEN_PROFILE_FORMAT(1)]);
+    print_counters("compress",        &profile.counters[CODEC_OP_COMPRESS][0]);
+    print_counters("decompress",      &profile.counters[CODEC_OP_DECOMPRESS][0]);
+
+    int failed = 0;
+#ifdef ENABLE_PROFILING
+    const int quantized_formats[] = {0, 1, TOKEN_PROFILE_FORMAT(0), TOKEN_PROFILE_FORMAT(1)};
+    for (int op = 0; op < CODEC_OP_COUNT; ++op) {
+        const int num_formats = (op == CODEC_OP_QUANTIZE || op == CODEC_OP_DEQUANTIZE) ? 4 : 1;
+        for (int i = 0; i < num_formats; ++i) {
+            const int f = quantized_formats[i];
+            const codec_counters_t *c = &profile.counters[op][f];
+            /* encoders read the floats and write the returned array, decoders the reverse */
+            const uint64_t encoded = (op == CODEC_OP_COMPRESS || op == CODEC_OP_DECOMPRESS) ? sparse_bytes : encoded_bytes[f];
+            const int encodes = op == CODEC_OP_QUANTIZE || op == CODEC_OP_COMPRESS;
+            const uint64_t bytes_in  = encodes ? X * N * sizeof(float) : encoded;
+            const uint64_t bytes_out = encodes ? encoded : X * N * sizeof(float);
+            if (c->calls != X || c->elements != X * N || c->bytes_in != bytes_in || c->bytes_out != bytes_out) {
+                fprintf(stderr, "unexpected counters for op %d format %d: calls=%lu elements=%lu in=%lu out=%lu\n",
+                        op, f, c->calls, c->elements, c->bytes_in, c->bytes_out);
+                failed = 1;
+            }
+        }
+    }
+#endif
+#ifdef ENABLE_TRACING
+    printf("   hooks: begin=%lu, end=%lu\n", begin_calls, end_calls);
+    if (begin_calls != 10 * X || end_calls != 10 * X) {
+        fprintf(stderr, "unexpected hook calls: begin=%lu end=%lu\n", begin_calls, end_calls);
+        failed = 1;
+    }
+#endif
+
+    free(out);
+    free_random_float_arrays(inputs, X);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
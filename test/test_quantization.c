@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <math.h>
+#include <string.h>
 
 #include "quantization.h"
 #include "random.h"
@@ -21,6 +22,194 @@ static void measure_metrics(const float *orig, const float *deq, uint64_t N,
     *max_abs = mx;
 }
 
+/* The fused metrics accumulate in float per block, so allow a small relative slack. */
+static int metrics_match(const codec_metrics_t *fused, double mae, double mse, double max_abs) {
+    const double tol = 1e-4;
+    return fabs(fused->mae - mae) <= tol * (mae + 1e-12)
+        && fabs(fused->mse - mse) <= tol * (mse + 1e-12)
+        && fabs(fused->max_abs - max_abs) <= tol * (max_abs + 1e-12);
+}
+
+/* Straightforward per-element q8_0 / q4_0 reference used to check the specialized block kernels. */
+static void reference_quantize(const float *x, uint64_t N, uint8_t qtype, uint64_t block_size,
+                               float *scales, uint8_t *data) {
+    const float qmax = (qtype == 0) ? 127.0f : 7.0f;
+    for (uint64_t b = 0; b * block_size < N; ++b) {
+        const uint64_t start = b * block_size;
+        const uint64_t remain = (start + block_size <= N) ? block_size : N - start;
+        float abs_max = 0.0f;
+        for (uint64_t i = 0; i < remain; ++i) if (fabsf(x[start + i]) > abs_max) abs_max = fabsf(x[start + i]);
+        const float scale = (abs_max > 0.0f) ? abs_max / qmax : 0.0f;
+        const float inv_scale = (scale > 0.0f) ? 1.0f / scale : 0.0f;
+        scales[b] = scale;
+        for (uint64_t i = 0; i < remain; ++i) {
+            long qi = lrintf(x[start + i] * inv_scale);
+            if (qi < -(long)qmax) qi = -(long)qmax;
+            if (qi >  (long)qmax) qi =  (long)qmax;
+            const uint64_t idx = start + i;
+            if (qtype == 0) data[idx] = (uint8_t)(int8_t)qi;
+            else if (idx % 2 == 0) data[idx / 2] = (uint8_t)((qi & 0x0F) << 4);
+            else data[idx / 2] |= (uint8_t)(qi & 0x0F);
+        }
+    }
+}
+
+/* Every specialized block size, the generic path and the partial tail block against the reference. */
+static int check_block_kernels(const float *x, uint64_t N) {
+    const uint64_t block_sizes[] = {16, 32, 64, 128, 24, 250};
+    for (size_t s = 0; s < sizeof(block_sizes) / sizeof(block_sizes[0]); ++s) {
+        for (uint8_t qtype = 0; qtype < 2; ++qtype) {
+            const uint64_t bs = block_sizes[s];
+            quantized_array_t *qa = (qtype == 0) ? allocate_q8_0_array(N, bs) : allocate_q4_0_array(N, bs);
+            if (!qa) return 1;
+            float *scales = malloc(qa->num_blocks * sizeof(float));
+            uint8_t *data = calloc(N, 1);
+            float *y = malloc(N * sizeof(float));
+            int ok = scales && data && y && quantize_into(x, qa, NULL) == 0 && dequantize(qa, y) == 0;
+
+            if (ok) {
+                reference_quantize(x, N, qtype, bs, scales, data);
+                const uint64_t data_bytes = (qtype == 0) ? N : (N + 1) / 2;
+                ok = memcmp(scales, qa->scales, qa->num_blocks * sizeof(float)) == 0
+                  && memcmp(data, qa->data, data_bytes) == 0;
+                for (uint64_t i = 0; ok && i < N; ++i) {
+                    const uint64_t b = i / bs;
+                    const int q = (qtype == 0) ? (int8_t)data[i]
+                                : (i % 2 == 0) ? (int8_t)data[i / 2] >> 4 : (int8_t)(data[i / 2] << 4) >> 4;
+                    ok = (y[i] == scales[b] * (float)q);
+                }
+            }
+
+            printf("   block_size=%3lu %s: %s\n", bs, qtype == 0 ? "q8_0" : "q4_0", ok ? "ok" : "MISMATCH");
+            free(y); free(data); free(scales);
+            free_quantized_array(qa);
+            if (!ok) return 1;
+        }
+    }
+    return 0;
+}
+
+/* Partial decodes must match the corresponding slice of a full dequantize. */
+static int check_ranges(const quantized_array_t *qa, const float *full, uint64_t N) {
+    const uint64_t ranges[][2] = {{0, 1}, {1, 37}, {31, 33}, {64, 4096}, {N - 1, 1}, {N - 1001, 1001}, {0, N}};
+    float *out = malloc(N * sizeof(float));
+    if (!out) return 1;
+
+    int ok = 1;
+    for (size_t r = 0; ok && r < sizeof(ranges) / sizeof(ranges[0]); ++r) {
+        ok = dequantize_range(qa, ranges[r][0], ranges[r][1], out) == 0
+          && memcmp(out, full + ranges[r][0], ranges[r][1] * sizeof(float)) == 0;
+    }
+
+    /* last token of a [tokens, 4096] view */
+    const uint64_t F = 4096;
+    ok = ok && dequantize_rows(qa, F, N / F - 1, 1, out) == 0
+            && memcmp(out, full + N - F, F * sizeof(float)) == 0;
+    ok = ok && dequantize_range(qa, N, 1, out) != 0;   /* out of bounds is rejected */
+
+    free(out);
+    return !ok;
+}
+
+/* Per-token quantization with 32-feature groups must reproduce the flat 32-element blocks exactly. */
+static int check_tokens(const float *x, const float *full, uint64_t N, uint8_t qtype) {
+    const uint16_t F = 4096;
+    const uint16_t T = (uint16_t)(N / F);
+    token_quantized_array_t *ta = NULL;
+    float *out = malloc(N * sizeof(float));
+    if (!out || quantize_tokens(x, T, F, qtype, 32, &ta)) {
+        free(out);
+        return 1;
+    }
+
+    int ok = dequantize_tokens(ta, out) == 0 && memcmp(out, full, N * sizeof(float)) == 0;
+
+    /* re-encode the last token on its own and read it back */
+    uint8_t *row_copy = malloc(ta->row_size);
+    const uint8_t *last_row = ta->rows + (uint64_t)(T - 1) * ta->row_size;
+    ok = ok && row_copy;
+    if (ok) memcpy(row_copy, last_row, ta->row_size);
+    ok = ok && quantize_token_row(x + N - F, ta, T - 1) == 0
+            && memcmp(row_copy, last_row, ta->row_size) == 0
+            && dequantize_token_row(ta, T - 1, out) == 0
+            && memcmp(out, full + N - F, F * sizeof(float)) == 0;
+
+    free(row_copy);
+    free(out);
+    free_token_quantized_array(ta);
+    return !ok;
+}
+
+/*
+ * Every format on one-signed (SiLU-like) data: fused vs measured metrics, the per-element error
+ * bound of half a step (a full step for the clamped edge of q5_0), partial decode and a
+ * serialize/load round trip. Asymmetric q4_1 must beat symmetric q4_0 on such data.
+ */
+static int check_formats(const float *input, uint64_t N) {
+    const char *names[QUANTIZED_TYPE_COUNT] = {"q8_0", "q4_0", "q4_1", "q5_0", "q5_1", "q8_1"};
+    float *x = malloc(N * sizeof(float));
+    float *y = malloc(N * sizeof(float));
+    float *z = malloc(N * sizeof(float));
+    double mse[QUANTIZED_TYPE_COUNT] = {0.0};
+    int ok = x && y && z;
+
+    for (uint64_t i = 0; ok && i < N; ++i) {
+        const float v = input[i] * 0.4f;
+        x[i] = v / (1.0f + expf(-v));
+    }
+
+    for (uint8_t qtype = 0; ok && qtype < QUANTIZED_TYPE_COUNT; ++qtype) {
+        quantized_array_t *qa = NULL, *loaded = NULL;
+        codec_metrics_t fused;
+        ok = quantize_with_metrics(x, N, qtype, &qa, &fused) == 0 && dequantize(qa, y) == 0;
+
+        double mae, max_abs;
+        if (ok) {
+            measure_metrics(x, y, N, &mae, &mse[qtype], &max_abs);
+            ok = metrics_match(&fused, mae, mse[qtype], max_abs);
+        }
+
+        /* reconstruction stays within half a quantization step of the input */
+        const uint64_t scales_per_block = (qtype == 2 || qtype == 4 || qtype == 5) ? 2 : 1;
+        const double steps = (qtype == 3) ? 1.0 : 0.5;
+        for (uint64_t i = 0; ok && i < N; ++i) {
+            const double d = fabs(qa->scales[(i / qa->block_size) * scales_per_block]);
+            ok = fabs((double)y[i] - x[i]) <= steps * d * (1.0 + 1e-5) + 1e-6;
+        }
+
+        ok = ok && check_ranges(qa, y, N) == 0;
+
+        if (ok) {
+            const uint64_t size = (uint64_t)get_quantized_array_size(qa);
+            uint8_t *buffer = malloc(size);
+            ok = buffer != NULL;
+            if (ok) {
+                memcpy(buffer, qa, sizeof(quantized_array_t));
+                memcpy(buffer + sizeof(quantized_array_t), qa->scales, size - sizeof(quantized_array_t));
+                loaded = load_quantized_array_from_buffer(buffer, size);
+                ok = loaded && dequantize(loaded, z) == 0 && memcmp(y, z, N * sizeof(float)) == 0;
+            }
+            free(buffer);
+        }
+
+        if (ok) {
+            const double bw = 8.0 * (double)get_quantized_array_size(qa) / (double)N;
+            printf("   %s:  B/W=%.5f, MAE=%.6f, MSE=%.8f, MaxAbs=%.6f, SQNR=%.3f dB\n",
+                   names[qtype], bw, mae, mse[qtype], max_abs, fused.sqnr_db);
+        } else {
+            printf("   %s:  MISMATCH\n", names[qtype]);
+        }
+        free_quantized_array(loaded);
+        free_quantized_array(qa);
+    }
+
+    ok = ok && mse[QUANTIZED_TYPE_Q4_1] < mse[QUANTIZED_TYPE_Q4_0]
+            && mse[QUANTIZED_TYPE_Q5_1] < mse[QUANTIZED_TYPE_Q4_1];
+
+    free(z); free(y); free(x);
+    return !ok;
+}
+
 int main(void)
 {
     /* ---- configuration --------------------------------------------------- */
@@ -41,7 +230,8 @@ int main(void)
     for (uint64_t k = 0; k < X; ++k) {
         /* ---- q4_0 ------------------------------------------------------- */
         quantized_array_t *qa4 = NULL;
-        if (quantize(inputs[k], N, 1 /*q4_0*/, &qa4) || !qa4) {
+        codec_metrics_t fused4;
+        if (quantize_with_metrics(inputs[k], N, 1 /*q4_0*/, &qa4, &fused4) || !qa4) {
             fprintf(stderr, "q4_0 quantisation failed on array %lu\n", k);
             free_random_float_arrays(inputs, X);
             return EXIT_FAILURE;
@@ -68,7 +258,8 @@ int main(void)
 
         /* ---- q8_0 ------------------------------------------------------- */
         quantized_array_t *qa8 = NULL;
-        if (quantize(inputs[k], N, 0 /*q8_0*/, &qa8) || !qa8) {
+        codec_metrics_t fused8;
+        if (quantize_with_metrics(inputs[k], N, 0 /*q8_0*/, &qa8, &fused8) || !qa8) {
             fprintf(stderr, "q8_0 quantisation failed on array %lu\n", k);
             free(y4);
             free_quantized_array(qa4);
@@ -98,6 +289,24 @@ int main(void)
         double mae8, mse8, maxabs8;
         measure_metrics(inputs[k], y8, N, &mae8, &mse8, &maxabs8);
 
+        if (k == 0 && (check_ranges(qa8, y8, N) || check_ranges(qa4, y4, N))) {
+            fprintf(stderr, "partial dequantize disagrees with the full dequantize\n");
+            free(y4); free(y8);
+            free_quantized_array(qa4);
+            free_quantized_array(qa8);
+            free_random_float_arrays(inputs, X);
+            return EXIT_FAILURE;
+        }
+
+        if (k == 0 && (check_tokens(inputs[k], y8, N, 0) || check_tokens(inputs[k], y4, N, 1))) {
+            fprintf(stderr, "per-token quantization disagrees with the flat block layout\n");
+            free(y4); free(y8);
+            free_quantized_array(qa4);
+            free_quantized_array(qa8);
+            free_random_float_arrays(inputs, X);
+            return EXIT_FAILURE;
+        }
+
         /* ---- report ------------------------------------------------------ */
         double size4_kb = get_quantized_array_size(qa4) / 1024.0;
         double size8_kb = get_quantized_array_size(qa8) / 1024.0;
@@ -105,10 +314,19 @@ int main(void)
         double bw8 = 8.0 * size8_kb * 1024.0 / (double)N;
 
         printf("[array %lu] N=%lu, blocks=%lu, original_size=%.3f KB\n", k, N, qa4->num_blocks, N * sizeof(float) / 1024.0);
-        printf("   Q8_0:  size=%.3f KB, B/W=%.5f, MAE=%.6f, MSE=%.6f, MaxAbs=%.6f\n",
-               size8_kb, bw8, mae8, mse8, maxabs8);
-        printf("   Q4_0:  size=%.3f KB, B/W=%.5f, MAE=%.6f, MSE=%.6f, MaxAbs=%.6f\n",
-               size4_kb, bw4, mae4, mse4, maxabs4);
+        printf("   Q8_0:  size=%.3f KB, B/W=%.5f, MAE=%.6f, MSE=%.6f, MaxAbs=%.6f, SQNR=%.3f dB\n",
+               size8_kb, bw8, mae8, mse8, maxabs8, fused8.sqnr_db);
+        printf("   Q4_0:  size=%.3f KB, B/W=%.5f, MAE=%.6f, MSE=%.6f, MaxAbs=%.6f, SQNR=%.3f dB\n",
+               size4_kb, bw4, mae4, mse4, maxabs4, fused4.sqnr_db);
+
+        if (!metrics_match(&fused8, mae8, mse8, maxabs8) || !metrics_match(&fused4, mae4, mse4, maxabs4)) {
+            fprintf(stderr, "fused metrics disagree with the dequantized error on array %lu\n", k);
+            free(y4); free(y8);
+            free_quantized_array(qa4);
+            free_quantized_array(qa8);
+            free_random_float_arrays(inputs, X);
+            return EXIT_FAILURE;
+        }
 
         /* ---- clean ------------------------------------------------------- */
         free(y4);   
@@ -117,6 +335,22 @@ int main(void)
         free_quantized_array(qa8);
     }
 
+    /* ---- block kernels: N chosen so the last block is partial ------------ */
+    printf("[block kernels] N=%lu\n", N - 7);
+    if (check_block_kernels(inputs[0], N - 7)) {
+        fprintf(stderr, "specialized block kernels disagree with the reference\n");
+        free_random_float_arrays(inputs, X);
+        return EXIT_FAILURE;
+    }
+
+    /* ---- all formats on one-signed activations --------------------------- */
+    printf("[formats] N=%lu, SiLU-shaped input\n", N);
+    if (check_formats(inputs[0], N)) {
+        fprintf(stderr, "quantization formats failed on one-signed data\n");
+        free_random_float_arrays(inputs, X);
+        return EXIT_FAILURE;
+    }
+
     free_random_float_arrays(inputs, X);
     return EXIT_SUCCESS;
 }
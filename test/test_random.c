@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+
+#include "random.h"
+
+static void measure_moments(const float *x, uint64_t N, double *mean, double *stddev, double *max_abs) {
+    double s = 0.0, ss = 0.0, mx = 0.0;
+    for (uint64_t i = 0; i < N; ++i) {
+        s  += x[i];
+        ss += (double)x[i] * x[i];
+        if (fabs(x[i]) > mx) mx = fabs(x[i]);
+    }
+    *mean    = s / (double)N;
+    *stddev  = sqrt(ss / (double)N - (*mean) * (*mean));
+    *max_abs = mx;
+}
+
+int main(void) {
+    /* ---- configuration --------------------------------------------------- */
+    const uint64_t N        = 112 * 3584 * 16;     /* elements per corpus            */
+    const uint64_t SEED     = 12345;
+    const uint64_t OFFSET   = 1000003;              /* odd jump-ahead into the stream */
+    const uint64_t SLICE    = 77777;
+
+    const random_config_t configs[] = {
+        { .distribution = RANDOM_UNIFORM, .minv = -10.0f, .maxv = 10.0f },
+        { .distribution = RANDOM_NORMAL, .mean = 0.0f, .stddev = 1.0f },
+        { .distribution = RANDOM_ACTIVATION, .stddev = 1.0f, .num_features = 3584,
+          .outlier_ratio = 0.01f, .outlier_scale = 50.0f },
+    };
+    const char *names[] = {"uniform", "normal", "activation"};
+    const int max_threads = omp_get_max_threads();
+
+    for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); ++c) {
+        float *ref = malloc(N * sizeof(float));
+        float *alt = malloc(N * sizeof(float));
+        if (!ref || !alt) {
+            fprintf(stderr, "malloc failed for %s buffers\n", names[c]);
+            free(ref); free(alt);
+            return EXIT_FAILURE;
+        }
+
+        /* ---- single thread reference vs all threads ---------------------- */
+        omp_set_num_threads(1);
+        double t0 = omp_get_wtime();
+        int failed = fill_random_float_array(ref, N, &configs[c], SEED, 0);
+        double t1 = omp_get_wtime();
+
+        omp_set_num_threads(max_threads);
+        failed |= fill_random_float_array(alt, N, &configs[c], SEED, 0);
+        double t2 = omp_get_wtime();
+
+        if (failed || memcmp(ref, alt, N * sizeof(float)) != 0) {
+            fprintf(stderr, "%s: output depends on the thread count\n", names[c]);
+            free(ref); free(alt);
+            return EXIT_FAILURE;
+        }
+
+        /* ---- jump-ahead reproduces the same slice ------------------------ */
+        if (fill_random_float_array(alt, SLICE, &configs[c], SEED, OFFSET) ||
+            memcmp(ref + OFFSET, alt, SLICE * sizeof(float)) != 0) {
+            fprintf(stderr, "%s: jump-ahead slice differs from the full stream\n", names[c]);
+            free(ref); free(alt);
+            return EXIT_FAILURE;
+        }
+
+        double mean, stddev, max_abs;
+        measure_moments(ref, N, &mean, &stddev, &max_abs);
+        printf("   %-10s: N=%lu, mean=%.4f, stddev=%.4f, MaxAbs=%.3f, 1 thread=%.3f ms, %d threads=%.3f ms\n",
+               names[c], N, mean, stddev, max_abs, (t1 - t0) * 1e3, max_threads, (t2 - t1) * 1e3);
+
+        free(ref);
+        free(alt);
+    }
+
+    return EXIT_SUCCESS;
+}
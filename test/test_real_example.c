@@ -99,9 +99,9 @@ int main(void) {
     printf("Loaded real example: tokens=%lu, embed=%lu, N=%lu\n", n_tokens, n_embed, N);
 
     // Quantization variants
-    const int qtypes[] = {0 /*q8_0*/, 1 /*q4_0*/};
-    const char *qnames[] = {"q8_0", "q4_0"};
-    for (size_t i = 0; i < 2; ++i) {
+    const int qtypes[] = {0 /*q8_0*/, 1 /*q4_0*/, 2 /*q4_1*/, 3 /*q5_0*/, 4 /*q5_1*/, 5 /*q8_1*/};
+    const char *qnames[] = {"q8_0", "q4_0", "q4_1", "q5_0", "q5_1", "q8_1"};
+    for (size_t i = 0; i < sizeof(qtypes) / sizeof(qtypes[0]); ++i) {
         int qtype = qtypes[i];
         const char *qname = qnames[i];
         char outfile[64];
@@ -151,6 +151,58 @@ int main(void) {
         free_quantized_array(qa);
     }
 
+    // Per-token quantization variants (one scale per token row)
+    const char *tnames[] = {"q8_0_token", "q4_0_token"};
+    for (size_t i = 0; i < 2; ++i) {
+        uint8_t qtype = (uint8_t)qtypes[i];
+        const char *tname = tnames[i];
+        char outfile[64];
+        snprintf(outfile, sizeof(outfile), "%s.bin", tname);
+
+        token_quantized_array_t *ta = NULL;
+        if (quantize_tokens(orig, (uint16_t)n_tokens, (uint16_t)n_embed, qtype, 0, &ta)) {
+            fprintf(stderr, "%s quantization failed\n", tname);
+            free(orig);
+            return EXIT_FAILURE;
+        }
+
+        float *rec = malloc(N * sizeof(float));
+        if (!rec) {
+            fprintf(stderr, "Malloc failed for %s recovery buffer\n", tname);
+            free_token_quantized_array(ta);
+            free(orig);
+            return EXIT_FAILURE;
+        }
+
+        if (dequantize_tokens(ta, rec)) {
+            fprintf(stderr, "%s dequantization failed\n", tname);
+            free(rec);
+            free_token_quantized_array(ta);
+            free(orig);
+            return EXIT_FAILURE;
+        }
+
+        double mae, mse, maxabs;
+        measure_metrics(orig, rec, N, &mae, &mse, &maxabs);
+
+        // Write recovered binary
+        if (write_recovered_binary(outfile, type, n_embed, n_tokens, tensor_size, rec) != 0) {
+            fprintf(stderr, "Failed to write %s\n", outfile);
+            free(rec);
+            free_token_quantized_array(ta);
+            free(orig);
+            return EXIT_FAILURE;
+        }
+
+        double size_kb = get_token_quantized_array_size(ta) / 1024.0;
+        double bw = 8.0 * size_kb * 1024.0 / (double)N;
+        printf("   %s: size=%.3f KB, B/W=%.5f, MAE=%.6f, MSE=%.6f, MaxAbs=%.6f\n",
+               tname, size_kb, bw, mae, mse, maxabs);
+
+        free(rec);
+        free_token_quantized_array(ta);
+    }
+
     // Sparsity variants
     const float ratios[] = {0.10f, 0.05f};
     const char *rnames[] = {"sparse0.10", "sparse0.05"};
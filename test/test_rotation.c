@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+
+#include "rotation.h"
+#include "quantization.h"
+#include "metrics.h"
+#include "random.h"
+
+static double measure_mse(const float *orig, const float *deq, uint64_t N) {
+    double s = 0.0;
+    for (uint64_t i = 0; i < N; ++i) {
+        const double e = (double)deq[i] - (double)orig[i];
+        s += e * e;
+    }
+    return s / (double)N;
+}
+
+/* The fast transform against the dense definition H[i][j] = (-1)^popcount(i & j) / sqrt(n). */
+static int check_against_dense(const float *x, uint64_t n) {
+    float *fast = malloc(n * sizeof(float));
+    if (!fast) return 1;
+    memcpy(fast, x, n * sizeof(float));
+
+    int ok = hadamard_transform(fast, n, n) == 0;
+    for (uint64_t i = 0; ok && i < n; ++i) {
+        double acc = 0.0;
+        for (uint64_t j = 0; j < n; ++j) {
+            acc += (__builtin_popcountll(i & j) % 2) ? -(double)x[j] : (double)x[j];
+        }
+        ok = fabs(acc / sqrt((double)n) - fast[i]) <= 1e-4 * (1.0 + fabs(acc));
+    }
+    free(fast);
+    return !ok;
+}
+
+/* Partial decodes of a rotated array must match the corresponding slice of a full dequantize. */
+static int check_ranges(const quantized_array_t *qa, const float *full, uint64_t N, uint64_t F) {
+    const uint64_t ranges[][2] = {{0, 1}, {1, 37}, {511, 2}, {F - 5, F + 10}, {N - 1, 1}, {0, N}};
+    float *out = malloc(N * sizeof(float));
+    if (!out) return 1;
+
+    int ok = 1;
+    for (size_t r = 0; ok && r < sizeof(ranges) / sizeof(ranges[0]); ++r) {
+        ok = dequantize_range(qa, ranges[r][0], ranges[r][1], out) == 0
+          && memcmp(out, full + ranges[r][0], ranges[r][1] * sizeof(float)) == 0;
+    }
+    ok = ok && dequantize_rows(qa, F, 3, 2, out) == 0
+            && memcmp(out, full + 3 * F, 2 * F * sizeof(float)) == 0;
+
+    free(out);
+    return !ok;
+}
+
+/*
+ * The tiled quantize_rotated must encode exactly what quantizing a fully rotated copy gives, for
+ * every format, and its metrics must match the error of dequantize() against the unrotated input.
+ */
+static int check_streamed(const float *input, uint64_t n, uint64_t num_features) {
+    const uint64_t R = hadamard_block_size(num_features);
+    float *work = malloc(n * sizeof(float));
+    float *out  = malloc(n * sizeof(float));
+    int failed = !work || !out;
+
+    for (uint8_t qtype = 0; !failed && qtype < QUANTIZED_TYPE_COUNT; ++qtype) {
+        quantized_array_t *ref = NULL, *qa = NULL;
+        codec_metrics_t metrics;
+        memcpy(work, input, n * sizeof(float));
+        failed = hadamard_transform(work, n, R) || quantize(work, n, qtype, &ref)
+              || quantize_rotated_with_metrics(input, n, num_features, qtype, &qa, &metrics)
+              || qa->rotation_size != R || get_quantized_array_size(qa) != get_quantized_array_size(ref)
+              || memcmp(qa->scales, ref->scales, get_quantized_array_size(qa) - sizeof(quantized_array_t)) != 0
+              || dequantize(qa, out);
+
+        double sum_sq = 0.0, max_abs = 0.0;
+        for (uint64_t i = 0; !failed && i < n; ++i) {
+            const double e = fabs((double)out[i] - (double)input[i]);
+            sum_sq += e * e;
+            if (e > max_abs) max_abs = e;
+        }
+        const double mse = sum_sq / (double)n;
+        failed = failed || fabs(metrics.mse - mse) > 1e-6 * (mse + 1e-12)
+                        || fabs(metrics.max_abs - max_abs) > 1e-6 * (max_abs + 1e-12);
+        free_quantized_array(ref);
+        free_quantized_array(qa);
+    }
+    free(work);
+    free(out);
+    return failed;
+}
+
+int main(void) {
+    /* ---- configuration --------------------------------------------------- */
+    const uint64_t NUM_TOKENS   = 112;
+    const uint64_t NUM_FEATURES = 3584;             /* 7 Hadamard blocks of 512 */
+    const uint64_t N            = NUM_TOKENS * NUM_FEATURES;
+    const uint64_t SEED         = 12345;
+
+    const random_config_t config = {
+        .distribution = RANDOM_ACTIVATION, .stddev = 1.0f, .num_features = NUM_FEATURES,
+        .outlier_ratio = 0.01f, .outlier_scale = 20.0f,
+    };
+    float *input = gen_random_float_buffer(N, &config, SEED);
+    float *work  = malloc(N * sizeof(float));
+    float *out   = malloc(N * sizeof(float));
+    if (!input || !work || !out) {
+        fprintf(stderr, "failed to allocate buffers\n");
+        free(input); free(work); free(out);
+        return EXIT_FAILURE;
+    }
+
+    /* ---- block size selection -------------------------------------------- */
+    int failed = hadamard_block_size(3584) != 512 || hadamard_block_size(4096) != 4096
+              || hadamard_block_size(7) != 1 || hadamard_block_size((uint64_t)1 << 40) != HADAMARD_MAX_BLOCK_SIZE
+              || hadamard_transform(work, N, 384) == 0 || hadamard_transform(work, 1000, 512) == 0;
+    if (failed) fprintf(stderr, "hadamard block size / argument checks failed\n");
+
+    /* ---- transform: dense reference, self inverse, thread independent ----- */
+    failed = failed || check_against_dense(input, 64);
+
+    const uint64_t R = hadamard_block_size(NUM_FEATURES);
+    memcpy(work, input, N * sizeof(float));
+    double t0 = omp_get_wtime();
+    failed = failed || hadamard_transform(work, N, R);
+    double t1 = omp_get_wtime();
+
+    memcpy(out, input, N * sizeof(float));
+    failed = failed || hadamard_transform_local(out, N, R) || memcmp(out, work, N * sizeof(float)) != 0;
+
+    failed = failed || hadamard_transform(out, N, R);
+    double energy_in = 0.0, energy_rot = 0.0, max_err = 0.0;
+    for (uint64_t i = 0; i < N; ++i) {
+        energy_in  += (double)input[i] * input[i];
+        energy_rot += (double)work[i] * work[i];
+        if (fabs(out[i] - input[i]) > max_err) max_err = fabs(out[i] - input[i]);
+    }
+    failed = failed || max_err > 1e-4 || fabs(energy_rot - energy_in) > 1e-4 * energy_in;
+    printf("[hadamard] N=%lu, block=%lu, time=%.3f ms, inverse MaxAbs=%.3g\n", N, R, (t1 - t0) * 1e3, max_err);
+    if (failed) {
+        fprintf(stderr, "hadamard transform is not an orthonormal involution\n");
+        free(input); free(work); free(out);
+        return EXIT_FAILURE;
+    }
+
+    /* ---- rotated vs plain quantization on activations with outliers ------- */
+    const char *names[] = {"q8_0", "q4_0"};
+    double mse_plain[2], mse_rotated[2];
+    for (uint8_t qtype = 0; !failed && qtype < 2; ++qtype) {
+        quantized_array_t *plain = NULL, *rotated = NULL, *loaded = NULL;
+        failed = quantize(input, N, qtype, &plain) || dequantize(plain, out);
+        if (!failed) mse_plain[qtype] = measure_mse(input, out, N);
+
+        t0 = omp_get_wtime();
+        failed = failed || quantize_rotated(input, N, NUM_FEATURES, qtype, &rotated);
+        t1 = omp_get_wtime();
+        failed = failed || rotated->rotation_size != R || dequantize(rotated, out);
+        double t2 = omp_get_wtime();
+        if (!failed) mse_rotated[qtype] = measure_mse(input, out, N);
+
+        failed = failed || check_ranges(rotated, out, N, NUM_FEATURES);
+
+        /* rotation_size survives serialization */
+        if (!failed) {
+            const uint64_t size = (uint64_t)get_quantized_array_size(rotated);
+            uint8_t *buffer = malloc(size);
+            failed = !buffer;
+            if (!failed) {
+                memcpy(buffer, rotated, sizeof(quantized_array_t));
+                memcpy(buffer + sizeof(quantized_array_t), rotated->scales, size - sizeof(quantized_array_t));
+                loaded = load_quantized_array_from_buffer(buffer, size);
+                failed = !loaded || dequantize(loaded, work) || memcmp(work, out, N * sizeof(float)) != 0;
+            }
+            free(buffer);
+        }
+
+        /* re-encoding unrotated data into a rotated array is refused and leaves it decoding as before */
+        failed = failed || quantize_into(input, rotated, NULL) == 0 || quantize_into(input, loaded, NULL) == 0
+                        || dequantize(rotated, work) || memcmp(work, out, N * sizeof(float)) != 0;
+
+        if (!failed) {
+            printf("   %s:  MSE=%.6f, rotated MSE=%.6f, quantize_rotated=%.3f ms, dequantize=%.3f ms\n",
+                   names[qtype], mse_plain[qtype], mse_rotated[qtype], (t1 - t0) * 1e3, (t2 - t1) * 1e3);
+        }
+        free_quantized_array(loaded);
+        free_quantized_array(rotated);
+        free_quantized_array(plain);
+    }
+
+    /* tiles spanning rows, a tile grown to one 8192 rotation block, and the smallest accepted block */
+    failed = failed || check_streamed(input, N, NUM_FEATURES) || check_streamed(input, 32 * 8192, 8192)
+                    || check_streamed(input, 7 * 96, 96);
+
+    /* rows whose rotation block would be too small to spread outliers are refused, not left unrotated */
+    const uint64_t narrow_features[] = {7, 3001, 3000, 16, 48};
+    for (size_t f = 0; !failed && f < sizeof(narrow_features) / sizeof(narrow_features[0]); ++f) {
+        quantized_array_t *qa = NULL;
+        const uint64_t n = 4 * narrow_features[f];
+        failed = hadamard_block_size(narrow_features[f]) >= HADAMARD_MIN_BLOCK_SIZE
+              || quantize_rotated(input, n, narrow_features[f], QUANTIZED_TYPE_Q4_0, &qa) == 0 || qa != NULL;
+        free_quantized_array(qa);
+    }
+
+    /* spreading the outliers must pay off for 4-bit */
+    failed = failed || !(mse_rotated[1] < 0.5 * mse_plain[1]);
+    if (failed) fprintf(stderr, "rotated quantization failed or did not reduce the q4_0 error\n");
+
+    free(input); free(work); free(out);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -22,6 +22,48 @@ static void measure_metrics(const float *orig, const float *decomp, uint64_t N,
     *max_abs = mx;
 }
 
+/* The fused metrics accumulate in float per block, so allow a small relative slack. */
+static int metrics_match(const codec_metrics_t *fused, double mae, double mse, double max_abs) {
+    const double tol = 1e-4;
+    return fabs(fused->mae - mae) <= tol * (mae + 1e-12)
+        && fabs(fused->mse - mse) <= tol * (mse + 1e-12)
+        && fabs(fused->max_abs - max_abs) <= tol * (max_abs + 1e-12);
+}
+
+/* Compressing into a reused, dirty array must give the same bytes as compress(). */
+static int check_compress_into(const float *input, const sparse_array_t *sa, float sparse_ratio) {
+    sparse_array_t *reused = allocate_sparse_array(sa->num_tokens, sa->num_features, sparse_ratio);
+    if (!reused) return 1;
+    const uint64_t size = get_sparse_array_size(sa);
+    memset(reused->sparse_indices, 0xFF, size - sizeof(sparse_array_t));
+    int failed = compress_into(input, reused, NULL) || size != get_sparse_array_size(reused)
+              || memcmp(reused->sparse_indices, sa->sparse_indices, size - sizeof(sparse_array_t)) != 0;
+    free_sparse_array(reused);
+    return failed;
+}
+
+/* Row and token-list decodes must match the corresponding rows of a full decompress. */
+static int check_rows(const sparse_array_t *sa, const float *full) {
+    const uint32_t F = sa->num_features;
+    const uint16_t last = (uint16_t)(sa->num_tokens - 1);
+    const uint16_t tokens[] = {last, 0, 7, last};
+    float *out = malloc((size_t)sa->num_tokens * F * sizeof(float));
+    if (!out) return 1;
+
+    int ok = decompress_rows(sa, last, 1, out) == 0
+          && memcmp(out, full + (size_t)last * F, F * sizeof(float)) == 0
+          && decompress_rows(sa, 3, 5, out) == 0
+          && memcmp(out, full + (size_t)3 * F, 5 * F * sizeof(float)) == 0
+          && decompress_tokens(sa, tokens, 4, out) == 0;
+    for (int i = 0; ok && i < 4; ++i) {
+        ok = memcmp(out + (size_t)i * F, full + (size_t)tokens[i] * F, F * sizeof(float)) == 0;
+    }
+    ok = ok && decompress_rows(sa, last, 2, out) != 0;   /* out of bounds is rejected */
+
+    free(out);
+    return !ok;
+}
+
 int main(void) {
     /* ---- configuration --------------------------------------------------- */
     const uint64_t X              = 10;            /* number of random arrays            */
@@ -51,8 +93,9 @@ int main(void) {
             const float sparse_ratio = SPARSE_RATIOS[r];
 
             sparse_array_t *sparse_array = NULL;
+            codec_metrics_t fused;
             /* ---- compress ------------------------------------------------- */
-            if (compress(inputs[k], NUM_TOKENS, NUM_FEATURES, sparse_ratio, &sparse_array)) {
+            if (compress_with_metrics(inputs[k], NUM_TOKENS, NUM_FEATURES, sparse_ratio, &sparse_array, &fused)) {
                 fprintf(stderr, "compress failed for array %lu, ratio %.2f\n", k, sparse_ratio);
                 free_sparse_array(sparse_array);
                 free_random_float_arrays(inputs, X);
@@ -76,6 +119,14 @@ int main(void) {
                 return EXIT_FAILURE;
             }
 
+            if (k == 0 && (check_rows(sparse_array, decomp) || check_compress_into(inputs[k], sparse_array, sparse_ratio))) {
+                fprintf(stderr, "partial decompress or compress_into disagrees with the full path (ratio %.2f)\n", sparse_ratio);
+                free(decomp);
+                free_sparse_array(sparse_array);
+                free_random_float_arrays(inputs, X);
+                return EXIT_FAILURE;
+            }
+
             /* ---- metrics --------------------------------------------------- */
             double mae, mse, maxabs;
             measure_metrics(inputs[k], decomp, N, &mae, &mse, &maxabs);
@@ -85,8 +136,16 @@ int main(void) {
             double size_sparse_kb = get_sparse_array_size(sparse_array) / 1024.0;
             double bw = 8.0 * size_sparse_kb * 1024.0 / (double)N;  /* bits per original element */
 
-            printf("   Sparse%.2f: sparsity=%.3f, size=%.3f KB, B/W=%.5f, MAE=%.6f, MSE=%.6f, MaxAbs=%.6f\n",
-                   sparse_ratio, sparsity_ratio_actual, size_sparse_kb, bw, mae, mse, maxabs);
+            printf("   Sparse%.2f: sparsity=%.3f, size=%.3f KB, B/W=%.5f, MAE=%.6f, MSE=%.6f, MaxAbs=%.6f, SQNR=%.3f dB\n",
+                   sparse_ratio, sparsity_ratio_actual, size_sparse_kb, bw, mae, mse, maxabs, fused.sqnr_db);
+
+            if (!metrics_match(&fused, mae, mse, maxabs)) {
+                fprintf(stderr, "fused metrics disagree with the decompressed error (array %lu, ratio %.2f)\n", k, sparse_ratio);
+                free(decomp);
+                free_sparse_array(sparse_array);
+                free_random_float_arrays(inputs, X);
+                return EXIT_FAILURE;
+            }
 
             /* ---- clean ----------------------------------------------------- */
             free(decomp);